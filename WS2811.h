@@ -9,24 +9,727 @@
 /*
  * WS2811 RGB LED driver.
  *
- * Note that all of the functions below probably read one byte beyond
- * the end of their input streams.
+ * Note that none of the functions below read beyond the end of their
+ * input streams, except for WS2811_OUT_1_RLE which may read 2 bytes
+ * ahead in flash.
  */
 
 #ifndef WS2811_h
 #define WS2811_h
 
-/* RGB value structure reordered for the WS2811's wiring. */
+#include <assert.h>
+#ifndef __AVR__
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#else
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#endif
+
+/*
+ * Pixel layout.  The routines output the bytes of a pixel in memory order,
+ * so the RGB_t fields are declared in the order the LEDs expect them,
+ * G, R, B for the WS2811.  For other parts define WS2811_ORDER before
+ * including WS2811.h as one of the orders below, e.g. WS2811_ORDER_RGBW
+ * for the SK6812 RGBW, and the fields are reordered at compile time at no
+ * cost to the output.  The W orders add a w field and make the pixels 4
+ * bytes, WS2811_PIXEL_BYTES, which the routines taking RGB_t arrays and
+ * the _PACKED routines (32 slices per pixel) support.  The palette, run
+ * length and gradient routines, WS2811_OUT_2_2, WS2811_OUT_3_1,
+ * WS2811_OUT_7_COMMON, WS2811_OUT_8_COMMON and WS2811_TRANSPOSE_8 are
+ * unrolled for 3-byte pixels and are only available for those.
+ * WS2811_C0 to WS2811_C2 name the colour fields in output order.
+ */
+#define WS2811_ORDER_GRB  0
+#define WS2811_ORDER_RGB  1
+#define WS2811_ORDER_BRG  2
+#define WS2811_ORDER_RBG  3
+#define WS2811_ORDER_GBR  4
+#define WS2811_ORDER_BGR  5
+#define WS2811_ORDER_GRBW 6
+#define WS2811_ORDER_RGBW 7
+
+#ifndef WS2811_ORDER
+# define WS2811_ORDER WS2811_ORDER_GRB
+#endif
+
+#if WS2811_ORDER == WS2811_ORDER_GRB || WS2811_ORDER == WS2811_ORDER_GRBW
+# define WS2811_C0 g
+# define WS2811_C1 r
+# define WS2811_C2 b
+#elif WS2811_ORDER == WS2811_ORDER_RGB || WS2811_ORDER == WS2811_ORDER_RGBW
+# define WS2811_C0 r
+# define WS2811_C1 g
+# define WS2811_C2 b
+#elif WS2811_ORDER == WS2811_ORDER_BRG
+# define WS2811_C0 b
+# define WS2811_C1 r
+# define WS2811_C2 g
+#elif WS2811_ORDER == WS2811_ORDER_RBG
+# define WS2811_C0 r
+# define WS2811_C1 b
+# define WS2811_C2 g
+#elif WS2811_ORDER == WS2811_ORDER_GBR
+# define WS2811_C0 g
+# define WS2811_C1 b
+# define WS2811_C2 r
+#elif WS2811_ORDER == WS2811_ORDER_BGR
+# define WS2811_C0 b
+# define WS2811_C1 g
+# define WS2811_C2 r
+#else
+# error "Unknown WS2811_ORDER"
+#endif
+
+/* Pick the one of G, R and B for the colour field C, e.g. WS2811_C0. */
+#define WS2811_PICK(C, G, R, B) WS2811_PICK_(C, G, R, B)
+#define WS2811_PICK_(C, G, R, B) WS2811_PICK_##C(G, R, B)
+#define WS2811_PICK_g(G, R, B) G
+#define WS2811_PICK_r(G, R, B) R
+#define WS2811_PICK_b(G, R, B) B
+
+/* RGB value structure reordered for the LEDs' wiring. */
+#if WS2811_ORDER >= WS2811_ORDER_GRBW
+# define WS2811_PIXEL_BYTES 4
+typedef struct __attribute__ ((__packed__)) {
+    uint8_t WS2811_C0;
+    uint8_t WS2811_C1;
+    uint8_t WS2811_C2;
+    uint8_t w;
+} RGB_t;
+#else
+# define WS2811_PIXEL_BYTES 3
 typedef struct __attribute__ ((__packed__)) {
-    uint8_t g;
-    uint8_t r;
-    uint8_t b;
+    uint8_t WS2811_C0;
+    uint8_t WS2811_C1;
+    uint8_t WS2811_C2;
 } RGB_t;
+#endif
 
 #ifndef ARRAYLEN
 #define ARRAYLEN(A) (sizeof(A) / sizeof(A[0]))
 #endif
 
+/*
+ * The bit timing is generated by counting CPU cycles so the routines
+ * depend on F_CPU.  They're written for 16MHz, where a bit is 20 cycles:
+ * 4 cycles hi, 12 cycles hi or lo depending on the bit value, 4 cycles lo.
+ * At 8MHz a bit is only 10 cycles, which isn't enough for most of them,
+ * so only WS2811_OUT_1 and WS2811_OUT_8_PACKED are available there, in
+ * versions written for 8MHz.  At 20MHz and 12MHz the 16MHz and 8MHz code
+ * respectively is used with 5 cycles of padding added to every bit, the
+ * WS2811_PAD_* strings below are inserted before every pin transition.
+ * At 20MHz WS2811_OUT_8_COMMON is also available, using the extra cycles
+ * for an eighth stream.
+ */
+#if !defined(F_CPU) && !defined(__AVR__)
+# define F_CPU 16000000UL         /* only used for the host cycle counts */
+#endif
+#ifndef F_CPU
+# error "F_CPU needs to be defined for WS2811.h"
+#elif F_CPU == 8000000 || F_CPU == 16000000
+# define WS2811_PAD_HI ""
+# define WS2811_PAD_DATA ""
+# define WS2811_PAD_LO ""
+#elif F_CPU == 12000000 || F_CPU == 20000000
+# define WS2811_PAD_HI "    nop                    ; 250ns lo\n"
+# define WS2811_PAD_DATA "    nop                    ; 250ns hi\n"
+# define WS2811_PAD_LO "    nop                    ; 1000ns hi or lo\n" \
+    "    nop\n" \
+    "    nop\n"
+#else
+# error "WS2811.h only supports 8, 12, 16 and 20MHz F_CPU values"
+#endif
+
+/*
+ * Inline asm multiplying the pixel count in A:B by WS2811_PIXEL_BYTES, by
+ * adding SA:SB, a copy of it, to it once per byte after the first.
+ */
+#define WS2811_ADD_LEN(A, B, SA, SB) \
+    "    add " A ", " SA "\n" \
+    "    adc " B ", " SB "\n"
+#if WS2811_PIXEL_BYTES == 4
+# define WS2811_MUL_LEN(A, B, SA, SB) WS2811_ADD_LEN(A, B, SA, SB) \
+    WS2811_ADD_LEN(A, B, SA, SB) WS2811_ADD_LEN(A, B, SA, SB)
+#else
+# define WS2811_MUL_LEN(A, B, SA, SB) WS2811_ADD_LEN(A, B, SA, SB) \
+    WS2811_ADD_LEN(A, B, SA, SB)
+#endif
+
+/*
+ * Upper bound of the time in microseconds that any of the output routines
+ * takes for LEN pixels per strip, with interrupts disabled: 24 (or 32)
+ * bits of 1.25us per pixel plus less than 3us of setup.
+ */
+#define WS2811_FRAME_US(LEN) ((uint32_t) (LEN) * 10 * WS2811_PIXEL_BYTES + 3)
+
+/*
+ * Longest low period that can safely be inserted between two pixels
+ * without the strips taking it as the reset (latch) signal.  The
+ * datasheets give 50us for the reset but many WS2812 parts latch after
+ * about 6us, so interrupt handlers running in the windows of
+ * WS2811_OUT_1_WINDOW need to finish within this time.
+ */
+#define WS2811_MAX_GAP_US 5
+
+/*
+ * Declare a 256-byte table in flash for the _LUT routines, e.g.
+ *   WS2811_LUT(gamma) = { 0, 0, 0, 0, 1, ... };
+ * They need it aligned to 256 bytes so that each pixel byte can be used
+ * directly as the low byte of the entry's address.
+ */
+#define WS2811_LUT(NAME) \
+    const uint8_t NAME[256] PROGMEM __attribute__((aligned(256)))
+
+/*
+ * Per-pixel increment, in 8.8 fixed point, of a colour value going from A
+ * to B in LEN pixels for WS2811_OUT_1_RAMP.  The values wrap around so
+ * negative increments work too.  The division is truncated so the values
+ * never overshoot B, which can leave the end of a long gradient slightly
+ * short of it.
+ */
+static inline uint16_t WS2811_gradient_step(uint8_t a, uint8_t b,
+        uint16_t len) {
+    return len > 1 ? (uint16_t) (((int32_t) b - a) * 256 / (len - 1)) : 0;
+}
+
+#ifndef __AVR__
+/*
+ * Host build: when not compiling for the AVR the output routines below
+ * are replaced with C versions that don't drive anything but record every
+ * call as a frame, so that code using the DEFINE_WS2811_*_FN functions
+ * can be run and tested natively.  Each frame holds the pixels that would
+ * have been shifted out on every strip, identified by the PORT argument
+ * (as a string) and the pin, and the number of CPU cycles the AVR routine
+ * takes at F_CPU.  The frames are passed to WS2811_host_frame(), which by
+ * default appends them to the file named by the WS2811_DUMP environment
+ * variable, one line per strip:
+ *   <frame number> <cycles> <port> <pin> <GGRRBB> <GGRRBB> ...
+ * with the pixel bytes in output order, 4 of them for the W orders.
+ * Define your own WS2811_host_frame() to inspect them in-process instead.
+ * WS2811_host_frames and WS2811_host_cycles count the frames and cycles
+ * so far.  The frame data is only valid during the WS2811_host_frame()
+ * call.  The _LENS_FN functions output one frame per phase.
+ */
+typedef struct {
+    const char *port;               /* PORT argument of the routine */
+    uint8_t pin;
+    const uint8_t *grb;             /* first pixel's G, R, B bytes */
+    uint8_t stride;                 /* bytes from one pixel to the next */
+} WS2811_host_strip_t;
+
+typedef struct {
+    uint32_t seq;                   /* frame number */
+    uint32_t cycles;                /* AVR routine duration in cycles */
+    uint16_t len;                   /* pixels per strip */
+    uint8_t nstrips;
+    WS2811_host_strip_t strip[16];
+} WS2811_host_frame_t;
+
+__attribute__((weak)) uint32_t WS2811_host_frames;
+__attribute__((weak)) uint32_t WS2811_host_cycles;
+
+__attribute__((weak)) void WS2811_host_frame(const WS2811_host_frame_t *f) {
+    static FILE *dump;
+    static uint8_t opened;
+    uint8_t i, k;
+    uint16_t n;
+
+    if (!opened) {
+        const char *name = getenv("WS2811_DUMP");
+
+        opened = 1;
+        if (name)
+            dump = fopen(name, "w");
+    }
+    if (!dump)
+        return;
+    for (i = 0; i < f->nstrips; i++) {
+        const WS2811_host_strip_t *s = &f->strip[i];
+
+        fprintf(dump, "%lu %lu %s %u", (unsigned long) f->seq,
+                (unsigned long) f->cycles, s->port, (unsigned) s->pin);
+        for (n = 0; n < f->len; n++) {
+            const uint8_t *p = s->grb + n * s->stride;
+
+            fputc(' ', dump);
+            for (k = 0; k < WS2811_PIXEL_BYTES; k++)
+                fprintf(dump, "%02x", p[k]);
+        }
+        fputc('\n', dump);
+    }
+    fflush(dump);
+}
+
+static inline void WS2811_host_strip(WS2811_host_frame_t *f,
+        const char *port, uint8_t pin, const void *grb, uint8_t stride) {
+    WS2811_host_strip_t *s = &f->strip[f->nstrips++];
+
+    s->port = port;
+    s->pin = pin;
+    s->grb = (const uint8_t *) grb;
+    s->stride = stride;
+}
+
+/*
+ * SETUP is the routine's fixed overhead in cycles at F_CPU, counted from
+ * its instructions.  WS2811_HOST_SETUP() picks the 16MHz or the 20MHz
+ * figure, the same at 12MHz as at 8MHz.  Below 16MHz only WS2811_OUT_1
+ * and WS2811_OUT_8_PACKED exist on the AVR, they give their own figure.
+ */
+#if F_CPU >= 20000000
+# define WS2811_HOST_SETUP(S16, S20) (S20)
+#else
+# define WS2811_HOST_SETUP(S16, S20) (S16)
+#endif
+
+static inline void WS2811_host_emit(WS2811_host_frame_t *f, uint16_t len,
+        uint16_t setup) {
+    f->seq = WS2811_host_frames++;
+    f->len = len;
+    f->cycles = (uint32_t) len * 8 * WS2811_PIXEL_BYTES * (F_CPU / 800000) +
+        setup;
+    WS2811_host_cycles += f->cycles;
+    WS2811_host_frame(f);
+}
+
+/* Turn LEN pixels of bit slices back into 8 strips of LEN pixels. */
+static inline uint8_t *WS2811_host_unslice(const uint8_t *data,
+        uint16_t len) {
+    size_t size = (size_t) len * 8 * WS2811_PIXEL_BYTES;
+    uint8_t *grb = (uint8_t *) malloc(size + 1);
+    uint16_t n;
+    uint8_t pin, i, v;
+
+    for (n = 0; n < len * WS2811_PIXEL_BYTES; n++)
+        for (pin = 0; pin < 8; pin++) {
+            for (v = 0, i = 0; i < 8; i++)
+                v = (v << 1) | ((data[n * 8 + i] >> pin) & 1);
+            grb[pin * len * WS2811_PIXEL_BYTES + n] = v;
+        }
+    return grb;
+}
+
+/* Copy LEN pixels through the _SCALE routines' SCALE or the _LUT's LUT. */
+static inline uint8_t *WS2811_host_map(const void *rgb, uint16_t len,
+        uint8_t scale, const uint8_t *lut) {
+    const uint8_t *src = (const uint8_t *) rgb;
+    uint8_t *grb = (uint8_t *) malloc((size_t) len * WS2811_PIXEL_BYTES + 1);
+    uint16_t n;
+
+    for (n = 0; n < len * WS2811_PIXEL_BYTES; n++)
+        grb[n] = lut ? lut[src[n]] : (uint8_t) (src[n] * scale >> 8);
+    return grb;
+}
+
+#if WS2811_PIXEL_BYTES == 3
+/* Expand LEN BITS-bit palette indices, packed from the high bits down. */
+static inline uint8_t *WS2811_host_expand(const uint8_t *idx, uint16_t len,
+        const RGB_t *pal, uint8_t bits) {
+    uint8_t *grb = (uint8_t *) malloc((size_t) len * 3 + 1);
+    uint16_t n;
+
+    for (n = 0; n < len; n++) {
+        uint8_t i = bits == 8 ? idx[n] :
+            (idx[n / 2] >> (n & 1 ? 0 : 4)) & 0x0f;
+
+        grb[n * 3 + 0] = pal[i].WS2811_C0;
+        grb[n * 3 + 1] = pal[i].WS2811_C1;
+        grb[n * 3 + 2] = pal[i].WS2811_C2;
+    }
+    return grb;
+}
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+/* Pick stream I's LEN bytes out of data interleaved byte by byte from N. */
+static inline uint8_t *WS2811_host_split(const void *data, uint16_t len,
+        uint8_t n, uint8_t i) {
+    const uint8_t *src = (const uint8_t *) data;
+    uint8_t *grb = (uint8_t *) malloc((size_t) len + 1);
+    uint16_t k;
+
+    for (k = 0; k < len; k++)
+        grb[k] = src[k * n + i];
+    return grb;
+}
+#if WS2811_PIXEL_BYTES == 3
+
+/*
+ * Encode LEN pixels into the runs read by WS2811_OUT_1_RLE, returning the
+ * number of bytes written to OUT, at most LEN * 4.
+ */
+static inline uint16_t WS2811_rle_encode(const RGB_t *rgb, uint16_t len,
+        uint8_t *out) {
+    uint8_t *p = out;
+    uint16_t n = 0, run;
+
+    while (n < len) {
+        for (run = 1; n + run < len && run < 256; run++)
+            if (rgb[n + run].g != rgb[n].g || rgb[n + run].r != rgb[n].r ||
+                    rgb[n + run].b != rgb[n].b)
+                break;
+        *p++ = run - 1;
+        *p++ = rgb[n].WS2811_C0;
+        *p++ = rgb[n].WS2811_C1;
+        *p++ = rgb[n].WS2811_C2;
+        n += run;
+    }
+    return p - out;
+}
+
+/* Expand the runs in DATA into LEN pixels. */
+static inline uint8_t *WS2811_host_unrle(const uint8_t *data, uint16_t len) {
+    uint8_t *grb = (uint8_t *) malloc((size_t) len * 3 + 1);
+    uint16_t n = 0, run;
+
+    for (; n < len; data += 4)
+        for (run = data[0] + 1; run && n < len; run--, n++) {
+            grb[n * 3 + 0] = data[1];
+            grb[n * 3 + 1] = data[2];
+            grb[n * 3 + 2] = data[3];
+        }
+    return grb;
+}
+
+/* Generate LEN pixels of the _RAMP routine's 8.8 fixed point steps. */
+static inline uint8_t *WS2811_host_ramp(RGB_t from, uint16_t dg,
+        uint16_t dr, uint16_t db, uint16_t len) {
+    uint8_t *grb = (uint8_t *) malloc((size_t) len * 3 + 1);
+    uint16_t g = from.WS2811_C0 << 8 | 0x80, r = from.WS2811_C1 << 8 | 0x80;
+    uint16_t b = from.WS2811_C2 << 8 | 0x80, n;
+
+    for (n = 0; n < len; n++, g += dg, r += dr, b += db) {
+        grb[n * 3 + 0] = g >> 8;
+        grb[n * 3 + 1] = r >> 8;
+        grb[n * 3 + 2] = b >> 8;
+    }
+    return grb;
+}
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+#define WS2811_OUT_1(PORT, PIN, RGB, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT, PIN, RGB, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, \
+            F_CPU < 16000000 ? 20 : WS2811_HOST_SETUP(18, 21)); \
+} while (0)
+
+#define WS2811_OUT_1_WINDOW(PORT, PIN, RGB, LEN, K) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    WS2811_host_strip(&f_, #PORT, PIN, RGB, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(20, 23) + \
+            (len_ ? len_ - 1 : 0) / (K) * 5); \
+} while (0)
+
+/* On the host the flash data is read like any other array. */
+#define WS2811_OUT_1_P(PORT, PIN, RGB, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT, PIN, RGB, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(19, 22)); \
+} while (0)
+
+#define WS2811_OUT_1_SCALE(PORT, PIN, RGB, LEN, SCALE) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_map(RGB, len_, SCALE, NULL); \
+    WS2811_host_strip(&f_, #PORT, PIN, grb_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(22, 25)); \
+    free(grb_); \
+} while (0)
+
+#define WS2811_OUT_1_LUT(PORT, PIN, RGB, LEN, LUT) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_map(RGB, len_, 0, LUT); \
+    WS2811_host_strip(&f_, #PORT, PIN, grb_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(22, 25)); \
+    free(grb_); \
+} while (0)
+
+#if WS2811_PIXEL_BYTES == 3
+#define WS2811_OUT_1_RLE(PORT, PIN, DATA, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_unrle(DATA, len_); \
+    WS2811_host_strip(&f_, #PORT, PIN, grb_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(13, 13)); \
+    free(grb_); \
+} while (0)
+
+#define WS2811_OUT_1_RAMP(PORT, PIN, FROM, DG, DR, DB, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_ramp(FROM, WS2811_PICK(WS2811_C0, DG, DR, DB), \
+            WS2811_PICK(WS2811_C1, DG, DR, DB), \
+            WS2811_PICK(WS2811_C2, DG, DR, DB), len_); \
+    WS2811_host_strip(&f_, #PORT, PIN, grb_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(13, 13)); \
+    free(grb_); \
+} while (0)
+
+#define WS2811_OUT_1_PAL8(PORT, PIN, IDX, LEN, PAL) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_expand(IDX, len_, PAL, 8); \
+    WS2811_host_strip(&f_, #PORT, PIN, grb_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(17, 17)); \
+    free(grb_); \
+} while (0)
+
+#define WS2811_OUT_1_PAL4(PORT, PIN, IDX, LEN, PAL) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_expand(IDX, len_, PAL, 4); \
+    WS2811_host_strip(&f_, #PORT, PIN, grb_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(20, 20)); \
+    free(grb_); \
+} while (0)
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+#define WS2811_OUT_2(PORT0, PIN0, RGB0, PORT1, PIN1, RGB1, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT0, PIN0, RGB0, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT1, PIN1, RGB1, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(34, 38)); \
+} while (0)
+
+#define WS2811_OUT_2_P(PORT0, PIN0, PORT1, PIN1, DATA, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb0_ = WS2811_host_split(DATA, len_ * WS2811_PIXEL_BYTES, 2, 0); \
+    uint8_t *grb1_ = WS2811_host_split(DATA, len_ * WS2811_PIXEL_BYTES, 2, 1); \
+    WS2811_host_strip(&f_, #PORT0, PIN0, grb0_, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT1, PIN1, grb1_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(27, 27)); \
+    free(grb0_); \
+    free(grb1_); \
+} while (0)
+
+#define WS2811_OUT_2_SCALE(PORT0, PIN0, RGB0, PORT1, PIN1, RGB1, LEN, SCALE) \
+        do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb0_ = WS2811_host_map(RGB0, len_, SCALE, NULL); \
+    uint8_t *grb1_ = WS2811_host_map(RGB1, len_, SCALE, NULL); \
+    WS2811_host_strip(&f_, #PORT0, PIN0, grb0_, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT1, PIN1, grb1_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(32, 32)); \
+    free(grb0_); \
+    free(grb1_); \
+} while (0)
+
+#define WS2811_OUT_2_LUT(PORT0, PIN0, RGB0, PORT1, PIN1, RGB1, LEN, LUT) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb0_ = WS2811_host_map(RGB0, len_, 0, LUT); \
+    uint8_t *grb1_ = WS2811_host_map(RGB1, len_, 0, LUT); \
+    WS2811_host_strip(&f_, #PORT0, PIN0, grb0_, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT1, PIN1, grb1_, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(32, 32)); \
+    free(grb0_); \
+    free(grb1_); \
+} while (0)
+
+#define WS2811_OUT_2_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT, PIN0, RGB0, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT, PIN1, RGB1, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(35, 38)); \
+} while (0)
+
+#define WS2811_OUT_3_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT, PIN0, RGB0, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT, PIN1, RGB1, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT, PIN2, RGB2, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(37, 40)); \
+} while (0)
+
+#define WS2811_OUT_4_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, PIN3, RGB3, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT, PIN0, RGB0, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT, PIN1, RGB1, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT, PIN2, RGB2, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT, PIN3, RGB3, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(39, 42)); \
+} while (0)
+
+#define WS2811_OUT_4_MASK(PORT, MASK0, RGB0, MASK1, RGB1, MASK2, RGB2, MASK3, RGB3, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    const uint8_t mask_[4] = { MASK0, MASK1, MASK2, MASK3 }; \
+    const RGB_t *rgb_[4] = { RGB0, RGB1, RGB2, RGB3 }; \
+    uint8_t i_, pin_; \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        for (i_ = 0; i_ < 4; i_++) \
+            if (mask_[i_] & (1 << pin_)) \
+                WS2811_host_strip(&f_, #PORT, pin_, rgb_[i_], \
+                        WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(48, 51)); \
+} while (0)
+
+#if WS2811_PIXEL_BYTES == 3
+#define WS2811_OUT_2_2(PORT0, PIN0, RGB0, PIN1, RGB1, \
+        PORT1, PIN2, RGB2, PIN3, RGB3, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT0, PIN0, RGB0, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT0, PIN1, RGB1, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT1, PIN2, RGB2, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT1, PIN3, RGB3, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(35, 35)); \
+} while (0)
+
+#define WS2811_OUT_3_1(PORT0, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, \
+        PORT1, PIN3, RGB3, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, #PORT0, PIN0, RGB0, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT0, PIN1, RGB1, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT0, PIN2, RGB2, WS2811_PIXEL_BYTES); \
+    WS2811_host_strip(&f_, #PORT1, PIN3, RGB3, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(35, 35)); \
+} while (0)
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+#define WS2811_OUT_4_COMMON_P(PORT, PIN0, PIN1, PIN2, PIN3, DATA, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_[4]; \
+    const uint8_t pin_[4] = { PIN0, PIN1, PIN2, PIN3 }; \
+    uint8_t i_; \
+    for (i_ = 0; i_ < 4; i_++) { \
+        grb_[i_] = WS2811_host_split(DATA, len_ * WS2811_PIXEL_BYTES, 4, i_); \
+        WS2811_host_strip(&f_, #PORT, pin_[i_], grb_[i_], WS2811_PIXEL_BYTES); \
+    } \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(39, 42)); \
+    for (i_ = 0; i_ < 4; i_++) \
+        free(grb_[i_]); \
+} while (0)
+
+#if WS2811_PIXEL_BYTES == 3
+#define WS2811_OUT_7_COMMON(PORT, PIN0, PIN1, PIN2, PIN3, PIN4, PIN5, PIN6, \
+        RGB, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    const RGB_t *rgb_ = (RGB); \
+    WS2811_host_strip(&f_, #PORT, PIN0, rgb_ + 0, 21); \
+    WS2811_host_strip(&f_, #PORT, PIN1, rgb_ + 1, 21); \
+    WS2811_host_strip(&f_, #PORT, PIN2, rgb_ + 2, 21); \
+    WS2811_host_strip(&f_, #PORT, PIN3, rgb_ + 3, 21); \
+    WS2811_host_strip(&f_, #PORT, PIN4, rgb_ + 4, 21); \
+    WS2811_host_strip(&f_, #PORT, PIN5, rgb_ + 5, 21); \
+    WS2811_host_strip(&f_, #PORT, PIN6, rgb_ + 6, 21); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(37, 37)); \
+} while (0)
+
+#define WS2811_OUT_8_COMMON(PORT, RGB, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    const RGB_t *rgb_ = (RGB); \
+    uint8_t pin_; \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        WS2811_host_strip(&f_, #PORT, pin_, rgb_ + pin_, 24); \
+    WS2811_host_emit(&f_, LEN, WS2811_HOST_SETUP(39, 39)); \
+} while (0)
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+#define WS2811_OUT_8_PACKED(PORT, DATA, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_unslice(DATA, len_); \
+    uint8_t pin_; \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        WS2811_host_strip(&f_, #PORT, pin_, \
+                grb_ + pin_ * len_ * WS2811_PIXEL_BYTES, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, \
+            F_CPU < 16000000 ? 14 : WS2811_HOST_SETUP(31, 34)); \
+    free(grb_); \
+} while (0)
+
+#define WS2811_OUT_8_PACKED_P(PORT, DATA, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb_ = WS2811_host_unslice(DATA, len_); \
+    uint8_t pin_; \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        WS2811_host_strip(&f_, #PORT, pin_, \
+                grb_ + pin_ * len_ * WS2811_PIXEL_BYTES, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(31, 34)); \
+    free(grb_); \
+} while (0)
+
+#define WS2811_OUT_16_PACKED(PORT0, DATA0, PORT1, DATA1, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint8_t *grb0_ = WS2811_host_unslice(DATA0, len_); \
+    uint8_t *grb1_ = WS2811_host_unslice(DATA1, len_); \
+    uint8_t pin_; \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        WS2811_host_strip(&f_, #PORT0, pin_, \
+                grb0_ + pin_ * len_ * WS2811_PIXEL_BYTES, WS2811_PIXEL_BYTES); \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        WS2811_host_strip(&f_, #PORT1, pin_, \
+                grb1_ + pin_ * len_ * WS2811_PIXEL_BYTES, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(30, 33)); \
+    free(grb0_); \
+    free(grb1_); \
+} while (0)
+
+#define WS2811_OUT_16_PACKED_P(PORT0, PORT1, DATA, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    uint16_t len_ = (LEN); \
+    uint16_t n_ = len_ * 8 * WS2811_PIXEL_BYTES; \
+    uint8_t *data0_ = WS2811_host_split(DATA, n_, 2, 0); \
+    uint8_t *data1_ = WS2811_host_split(DATA, n_, 2, 1); \
+    uint8_t *grb0_ = WS2811_host_unslice(data0_, len_); \
+    uint8_t *grb1_ = WS2811_host_unslice(data1_, len_); \
+    uint8_t pin_; \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        WS2811_host_strip(&f_, #PORT0, pin_, \
+                grb0_ + pin_ * len_ * WS2811_PIXEL_BYTES, WS2811_PIXEL_BYTES); \
+    for (pin_ = 0; pin_ < 8; pin_++) \
+        WS2811_host_strip(&f_, #PORT1, pin_, \
+                grb1_ + pin_ * len_ * WS2811_PIXEL_BYTES, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, len_, WS2811_HOST_SETUP(30, 33)); \
+    free(data0_); \
+    free(data1_); \
+    free(grb0_); \
+    free(grb1_); \
+} while (0)
+
+#define WS2811_IRQ_SAVE(S) uint8_t S = 0
+#define WS2811_IRQ_RESTORE(S) (void) (S)
+
+#elif F_CPU >= 16000000
+
 /*
  * Inline asm macro to output 24-bit GRB value in (G,R,B) order, MSBit first.
  * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
@@ -38,17 +741,17 @@ typedef struct __attribute__ ((__packed__)) {
 #define WS2811_OUT_1(PORT, PIN, RGB, LEN) \
 asm volatile( \
 /* initialise */ \
-"    movw r18, %A[len]    ; multiply len by 3\n" \
-"    add %A[len], r18\n" \
-"    adc %B[len], r19\n" \
-"    add %A[len], r18\n" \
-"    adc %B[len], r19\n" \
+"    movw r18, %A[len]    ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
 "    ldi r17, 7           ; load inner loop counter\n" \
 "    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
 "    cli\n" \
 "    rjmp 6f             ; start with the end-of-loop check\n" \
 /* loop over the first 7 bits */ \
-"1:  sbi  %[port], %[pin] ; pin lo -> hi\n" \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
 "    sbrc r18, 7          ; test hi bit clear\n" \
 "    rjmp 2f              ; true, skip pin hi -> lo\n" \
 "    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
@@ -62,11 +765,14 @@ asm volatile( \
 "    nop\n" \
 "    lsl r18              ; shift to next bit\n" \
 "    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
 "    cbi %[port], %[pin]  ; pin hi -> lo\n" \
 "    brne 1b              ; (inner) loop if required\n" \
 "    ldi r17, 7           ; reload inner loop counter\n" \
 /* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
 "    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
 "    sbrc r18, 7          ; test hi bit clear\n" \
 "    rjmp 4f              ; true, skip pin hi -> lo\n" \
 "    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
@@ -75,11 +781,15 @@ asm volatile( \
 "5:  nop                  ; pulse timing delay\n" \
 "    nop\n" \
 "    nop\n" \
-"    nop\n" \
-"6:  ld r18, %a[rgb]+     ; load next byte\n" \
-"    sbiw %A[len], 1      ; decrement outer loop counter, set flags\n" \
+"6:  sbiw %A[len], 1      ; decrement outer loop counter, set flags\n" \
+"    brlt 7f              ; no more bytes, don't load beyond the end\n" \
+"    ld r18, %a[rgb]+     ; load next byte\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 1b              ; (outer) loop\n" \
+"7:  nop                  ; equalise delay of both code paths\n" \
+WS2811_PAD_LO \
 "    cbi %[port], %[pin]  ; pin hi -> lo\n" \
-"    brge 1b              ; (outer) loop if required \n" \
 "    out __SREG__, r16    ; reenable interrupts if required\n" \
 : \
 : [rgb] "e" (RGB), \
@@ -89,6 +799,96 @@ asm volatile( \
 : "r16", "r17", "r18", "r19", "cc", "memory" \
 )
 
+/*
+ * Same as WS2811_OUT_1 but instead of keeping interrupts disabled for the
+ * whole frame it restores SREG for a moment after every K pixels (1 to
+ * 84, or 63 with 4-byte pixels), which lets a pending interrupt run
+ * between two pixels.  The strip sees the interrupt handler's run time
+ * as a longer low period after the last bit of the pixel.  That needs to
+ * stay under WS2811_MAX_GAP_US or the strip latches the pixels so far
+ * and takes the rest as a new frame, so only use this with short
+ * interrupt handlers.  Interrupts are held off for at most
+ * WS2811_FRAME_US(K), e.g. 33us for K = 1 compared to 9ms for a whole
+ * 300 pixel frame.  Counting the instructions below at 16MHz, the first
+ * window's out comes 21 cycles of setup and K * 480 cycles of bits after
+ * the start (24 and K * 600 at 20MHz).  A window takes brne not taken,
+ * ldi, out, nop, cli and rjmp, 7 cycles instead of the 2 of brne, so the
+ * next windows follow every K * 480 + 5 (K * 600 + 5) cycles.
+ * r18 = byte to be output
+ * r18:r19 = temp value
+ * r19 = bytes until the next window
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_1_WINDOW(PORT, PIN, RGB, LEN, K) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]    ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    ldi r19, %[kb] + 1   ; bytes until the first window\n" \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    rjmp 6f             ; start with the end-of-loop check\n" \
+/* loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 4f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"4:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 5f\n" \
+"5:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"6:  sbiw %A[len], 1      ; decrement outer loop counter, set flags\n" \
+"    brlt 7f              ; no more bytes, don't load beyond the end\n" \
+"    ld r18, %a[rgb]+     ; load next byte\n" \
+"    dec r19              ; count bytes until the next window, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (outer) loop\n" \
+"    ldi r19, %[kb]       ; K pixels done, open a window\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+"    nop                  ; a pending interrupt runs here\n" \
+"    cli\n" \
+"    rjmp 1b              ; (outer) loop\n" \
+"7:  nop                  ; equalise delay of both code paths\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+: \
+: [rgb] "e" (RGB), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN), \
+  [kb] "M" ((K) * WS2811_PIXEL_BYTES) \
+: "r16", "r17", "r18", "r19", "cc", "memory" \
+)
+
 /*
  * Inline asm macro to output two streams of 24-bit GRB values in
  * (G,R,B) order, MSBit first.
@@ -115,11 +915,8 @@ asm volatile( \
 #define WS2811_OUT_2(PORT0, PIN0, RGB0, PORT1, PIN1, RGB1, LEN) \
 asm volatile( \
 /* initialise */ \
-"    movw r18, %A[len]      ; multiply len by 3\n" \
-"    add %A[len], r18\n" \
-"    adc %B[len], r19\n" \
-"    add %A[len], r18\n" \
-"    adc %B[len], r19\n" \
+"    movw r18, %A[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
 "    in r18, %[port0]\n" \
 "    in r19, %[port1]\n" \
 "    movw r20, r18\n" \
@@ -130,11 +927,21 @@ asm volatile( \
 "    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
 "    cli\n" \
 "    rjmp 2f               ; start with the end-of-loop check\n" \
+/* last byte - finish the 8th bit without loading */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    rjmp 4f\n" \
 /* loop over the first 7 bits */ \
-"1:  out %[port0], r20      ; pin0 lo -> hi\n" \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
 "    out %[port1], r21      ; pin1 lo -> hi\n" \
 "    nop\n" \
 "    nop\n" \
+WS2811_PAD_DATA \
 "    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
 "    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
 "    nop\n" \
@@ -147,24 +954,28 @@ asm volatile( \
 "    bst r15, 7\n" \
 "    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
 "    dec r17                ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
 "    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
 "    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
 "    brne 1b                ; (inner) loop if required\n" \
 "    ldi r17, 7             ; reload inner loop counter\n" \
 /* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
 "    out %[port0], r20      ; pin0 lo -> hi\n" \
 "    out %[port1], r21      ; pin1 lo -> hi\n" \
-"    nop\n" \
-"    nop\n" \
+"2:  sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+WS2811_PAD_DATA \
 "    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
 "    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
-"2:  ld r14, %a[rgb0]+      ; load next stream 0 byte\n" \
+"    brlt 3b                ; no more bytes, don't load beyond the end\n" \
+"    ld r14, %a[rgb0]+      ; load next stream 0 byte\n" \
 "    ld r15, %a[rgb1]+      ; load next stream 1 byte\n" \
 "    bst r14, 7\n" \
 "    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
 "    bst r15, 7\n" \
 "    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
-"    sbiw %A[len], 1        ; decrement outer loop counter\n" \
+"4:  nop\n" \
+WS2811_PAD_LO \
 "    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
 "    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
 "    brge 1b                ; (outer) loop if required\n" \
@@ -182,235 +993,5184 @@ asm volatile( \
 )
 
 /*
- * Inline asm macro to output three streams of 24-bit GRB values in
- * (G,R,B) order, MSBit first.  The three output pins must be on the same
- * atmega port.
- * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
- * r18 = stream 0 byte to be output
- * r19 = stream 1 byte to be output
- * r20 = stream 2 byte to be output
- * r21 = original port value with all three pins low
- * r22 = original port value with all three pins high
- * r23 = original port value with the 3 pins set to their next output values
- * r24 = (+r25) outer loop counter
+ * Same as WS2811_OUT_1 but every byte is scaled by SCALE / 256 as it is
+ * loaded, in the cycles the 8th bit otherwise spends waiting, so that
+ * the whole strip can be dimmed without touching the pixel buffer.  A
+ * SCALE of 255 is just short of full brightness, use WS2811_OUT_1 for
+ * that.  Uses mul, which isn't available on the ATtinys.
+ * r18 = byte to be output
+ * r18:r19 = temp value
+ * r0:r1 = scaled byte, r1 is cleared again at the end
  * r16 = saved SREG
  * r17 = inner loop counter
- *
- * NOTE: a similar 4-pin version would also be possible but we'd need to
- * unroll the last two iterations to save enough cycles instead of only the
- * single last iteration.
- * Instead if you need 4 or more parallel outputs you're probably better off
- * with the approach where the output bits are pre-grouped into atmega port
- * values.
  */
-#define WS2811_OUT_3_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, LEN) \
+#define WS2811_OUT_1_SCALE(PORT, PIN, RGB, LEN, SCALE) \
 asm volatile( \
 /* initialise */ \
-"    movw r24, %[len]      ; multiply len by 3\n" \
-"    add r24, %A[len]\n" \
-"    adc r25, %B[len]\n" \
-"    add r24, %A[len]\n" \
-"    adc r25, %B[len]\n" \
-"    in r21, %[port]\n" \
-"    mov r22, r21\n" \
-"    sbr r22, (1 << %[pin0]) | (1 << %[pin1]) | (1 << %[pin2])\n" \
-"    mov r23, r21\n" \
-"    ldi r17, 7             ; load inner loop counter\n" \
-"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    movw r18, %A[len]    ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
 "    cli\n" \
-"    rjmp 2f                ; start with the end-of-loop check\n" \
+"    rjmp 5f             ; start with the end-of-loop check\n" \
 /* loop over the first 7 bits */ \
-"1:  out %[port], r22       ; pins lo -> hi\n" \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
 "    nop\n" \
 "    nop\n" \
 "    nop\n" \
-"    out %[port], r23       ; pins hi -> colour output bit\n" \
 "    nop\n" \
 "    nop\n" \
-"    lsl r18                ; shift stream 0 byte to next bit, set Carry\n" \
-"    bst r18, 7\n" \
-"    bld r23, %[pin0]       ; load r18 bit 7 into pin0\n" \
-"    lsl r19                ; shift stream 0 byte to next bit, set Carry\n" \
-"    bst r19, 7\n" \
-"    bld r23, %[pin1]       ; load r19 bit 7 into pin1\n" \
-"    lsl r20                ; shift stream 1 byte to next bit, set Carry\n" \
-"    bst r20, 7\n" \
-"    bld r23, %[pin2]       ; load r20 bit 7 into pin2\n" \
-"    out %[port], r21       ; pins hi -> lo if not already low\n" \
-"    dec r17                ; decrement loop counter, set flags\n" \
-"    brne 1b                ; (inner) loop if required\n" \
-"    ldi r17, 7             ; reload inner loop counter\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
 /* 8th bit - output & fetch next values */ \
-"    out %[port], r22       ; pins lo -> hi\n" \
-"2:  ld r18, %a[rgb0]+      ; load next stream 0 byte\n" \
-"    bst r18, 7\n" \
-"    out %[port], r23       ; pins hi -> colour output bit\n" \
-"    bld r23, %[pin0]       ; load r18 bit 7 into pin0\n" \
-"    ld r19, %a[rgb1]+      ; load next stream 1 byte\n" \
-"    bst r19, 7\n" \
-"    bld r23, %[pin1]       ; load r19 bit 7 into pin1\n" \
-"    ld r20, %a[rgb2]+      ; load next stream 2 byte\n" \
-"    bst r20, 7\n" \
-"    bld r23, %[pin2]       ; load r20 bit 7 into pin2\n" \
-"    sbiw r24, 1            ; decrement outer loop counter\n" \
-"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 4f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"4:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 5f\n" \
+"5:  sbiw %A[len], 1      ; decrement outer loop counter, set flags\n" \
+"    brlt 6f              ; no more bytes, don't load beyond the end\n" \
+"    ld r18, %a[rgb]+     ; load next byte\n" \
+"    mul r18, %[scale]    ; scale it\n" \
+"    mov r18, r1\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 1b              ; (outer) loop\n" \
+"6:  nop                  ; equalise delay of both code paths\n" \
 "    nop\n" \
-"    brge 1b                ; (outer) loop if required\n" \
-"    out __SREG__, r16      ; reenable interrupts if required\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+"    clr __zero_reg__\n" \
 : \
-: [rgb0] "e" (RGB0), \
-  [rgb1] "e" (RGB1), \
-  [rgb2] "e" (RGB2), \
-  [len] "r" (LEN), /* For some reason we can't use "w" here to get r24 */ \
+: [rgb] "e" (RGB), \
+  [len] "w" (LEN), \
+  [scale] "r" ((uint8_t) (SCALE)), \
   [port] "I" (_SFR_IO_ADDR(PORT)), \
-  [pin0] "I" (PIN0), \
-  [pin1] "I" (PIN1), \
-  [pin2] "I" (PIN2) \
-: "r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23", "r24", "r25", \
-  "cc", "memory" \
+  [pin] "I" (PIN) \
+: "r16", "r17", "r18", "r19", "cc", "memory" \
 )
 
 /*
- * Inline asm macro to output four streams of 24-bit GRB values in
+ * Same as WS2811_OUT_1 but every byte is replaced with its entry in LUT,
+ * a 256-byte table in flash declared with WS2811_LUT(), e.g. a gamma
+ * curve, as it is loaded.  The table being aligned, the byte is loaded
+ * straight into the low byte of Z so the lookup is a single lpm.
+ * r18 = byte to be output
+ * r18:r19 = temp value
+ * r30:r31 = LUT entry address
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_1_LUT(PORT, PIN, RGB, LEN, LUT) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]    ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    mov r31, %B[lut]     ; table page, the low byte comes from the data\n" \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    rjmp 5f             ; start with the end-of-loop check\n" \
+/* loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 4f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"4:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 5f\n" \
+"5:  sbiw %A[len], 1      ; decrement outer loop counter, set flags\n" \
+"    brlt 6f              ; no more bytes, don't load beyond the end\n" \
+"    ld r30, %a[rgb]+     ; load next byte\n" \
+"    lpm r18, Z           ; look it up\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 1b              ; (outer) loop\n" \
+"6:  nop                  ; equalise delay of both code paths\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+: \
+: [rgb] "e" (RGB), \
+  [len] "w" (LEN), \
+  [lut] "r" (LUT), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN) \
+: "r16", "r17", "r18", "r19", "r30", "r31", "cc", "memory" \
+)
+
+/*
+ * Same as WS2811_OUT_2 but every byte is scaled by SCALE / 256 as it is
+ * loaded, like in WS2811_OUT_1_SCALE.  Two loads and two multiplies don't
+ * fit in the 8th bit, so the 7th bit is taken out of the inner loop too:
+ * the next bytes are loaded in the 7th bit, once the current bytes' 8th
+ * bits are in r22 and r23, and scaled in the 8th.  Uses mul, which isn't
+ * available on the ATtinys.
+ * r14 = stream 0 byte to be output
+ * r15 = stream 1 byte to be output
+ * r18 = port 0 original value with stream 0 pin low
+ * r19 = port 1 original value with stream 1 pin low
+ * r20 = port 0 original value with stream 0 pin high
+ * r21 = port 1 original value with stream 1 pin high
+ * r22 = port 0 original value with stream 0 pin set to the next output bit
+ * r23 = port 1 original value with stream 1 pin set to the next output bit
+ * r18:r19 = temp value
+ * r0:r1 = scaled byte, r1 is cleared again at the end
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_2_SCALE(PORT0, PIN0, RGB0, PORT1, PIN1, RGB1, LEN, SCALE) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    in r18, %[port0]\n" \
+"    in r19, %[port1]\n" \
+"    movw r20, r18\n" \
+"    sbr r20, 1 << %[pin0]\n" \
+"    sbr r21, 1 << %[pin1]\n" \
+"    movw r22, r18\n" \
+"    ldi r17, 6             ; load inner loop counter\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 5f               ; nothing to output\n" \
+/* last byte - finish the 7th bit without loading */ \
+"3:  nop\n" \
+"    nop\n" \
+"    rjmp 4f\n" \
+/* load and scale the first bytes before the timing starts */ \
+"2:  ld r14, %a[rgb0]+\n" \
+"    ld r15, %a[rgb1]+\n" \
+"    mul r14, %[scale]\n" \
+"    mov r14, r1\n" \
+"    mul r15, %[scale]\n" \
+"    mov r15, r1\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+/* loop over the first 6 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r14                ; shift stream 0 byte to next bit, set Carry\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    lsl r15                ; shift stream 1 byte to next bit, set Carry\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    dec r17                ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r17, 6             ; reload inner loop counter\n" \
+/* 7th bit - fetch next values */ \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    bst r14, 6\n" \
+"    bld r22, %[pin0]       ; load r14 bit 6 into pin0\n" \
+"    bst r15, 6\n" \
+"    bld r23, %[pin1]       ; load r15 bit 6 into pin1\n" \
+"    brlt 3b                ; no more bytes, don't load beyond the end\n" \
+"    ld r14, %a[rgb0]+      ; load next stream 0 byte\n" \
+"    ld r15, %a[rgb1]+      ; load next stream 1 byte\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    mul r14, %[scale]      ; scale stream 0 byte\n" \
+/* 8th bit - scale the next values */ \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    mov r14, r1\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    mul r15, %[scale]      ; scale stream 1 byte\n" \
+"    mov r15, r1\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    nop\n" \
+"    brlt 6f                ; all bytes done, mul leaves S alone\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+"6:\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    out __SREG__, r16      ; reenable interrupts if required\n" \
+"5:  clr __zero_reg__\n" \
+: \
+: [rgb0] "e" (RGB0), \
+  [rgb1] "e" (RGB1), \
+  [len] "w" (LEN), \
+  [scale] "r" ((uint8_t) (SCALE)), \
+  [port0] "I" (_SFR_IO_ADDR(PORT0)), \
+  [port1] "I" (_SFR_IO_ADDR(PORT1)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1) \
+: "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23", \
+  "cc", "memory" \
+)
+
+/*
+ * Same as WS2811_OUT_2 but every byte is replaced with its entry in LUT,
+ * a 256-byte table in flash declared with WS2811_LUT(), as it is loaded,
+ * like in WS2811_OUT_1_LUT.  The loads and lookups are split between the
+ * 7th and 8th bits the same way as in WS2811_OUT_2_SCALE.  Z is used for
+ * the lookups so RGB0 and RGB1 have to go in X and Y, which fails to
+ * compile if the function needs Y as its frame pointer.
+ * r14 = stream 0 byte to be output
+ * r15 = stream 1 byte to be output
+ * r18 = port 0 original value with stream 0 pin low
+ * r19 = port 1 original value with stream 1 pin low
+ * r20 = port 0 original value with stream 0 pin high
+ * r21 = port 1 original value with stream 1 pin high
+ * r22 = port 0 original value with stream 0 pin set to the next output bit
+ * r23 = port 1 original value with stream 1 pin set to the next output bit
+ * r18:r19 = temp value
+ * r30:r31 = LUT entry address
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_2_LUT(PORT0, PIN0, RGB0, PORT1, PIN1, RGB1, LEN, LUT) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    in r18, %[port0]\n" \
+"    in r19, %[port1]\n" \
+"    movw r20, r18\n" \
+"    sbr r20, 1 << %[pin0]\n" \
+"    sbr r21, 1 << %[pin1]\n" \
+"    movw r22, r18\n" \
+"    mov r31, %B[lut]       ; table page, the low byte comes from the data\n" \
+"    ldi r17, 6             ; load inner loop counter\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 5f               ; nothing to output\n" \
+/* last byte - finish the 7th bit, the stream 1 load below rereads it */ \
+"3:  ld r30, -%a[rgb1]     ; step back without touching the flags\n" \
+"    rjmp 4f\n" \
+/* load and look up the first bytes before the timing starts */ \
+"2:  ld r30, %a[rgb0]+\n" \
+"    lpm r14, Z\n" \
+"    ld r30, %a[rgb1]+\n" \
+"    lpm r15, Z\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+/* loop over the first 6 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r14                ; shift stream 0 byte to next bit, set Carry\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    lsl r15                ; shift stream 1 byte to next bit, set Carry\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    dec r17                ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r17, 6             ; reload inner loop counter\n" \
+/* 7th bit - fetch next values */ \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    bst r14, 6\n" \
+"    bld r22, %[pin0]       ; load r14 bit 6 into pin0\n" \
+"    bst r15, 6\n" \
+"    bld r23, %[pin1]       ; load r15 bit 6 into pin1\n" \
+"    brlt 3b                ; no more bytes, don't load beyond the end\n" \
+"    ld r30, %a[rgb0]+      ; load next stream 0 byte\n" \
+"    lpm r14, Z             ; look it up\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    ld r30, %a[rgb1]+      ; load next stream 1 byte\n" \
+/* 8th bit - look up the next stream 1 value */ \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    lpm r15, Z             ; look it up\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    nop\n" \
+"    brlt 6f                ; all bytes done\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+"6:\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    out __SREG__, r16      ; reenable interrupts if required\n" \
+"5:\n" \
+: \
+: [rgb0] "e" (RGB0), \
+  [rgb1] "e" (RGB1), \
+  [len] "w" (LEN), \
+  [lut] "r" (LUT), \
+  [port0] "I" (_SFR_IO_ADDR(PORT0)), \
+  [port1] "I" (_SFR_IO_ADDR(PORT1)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1) \
+: "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23", \
+  "r30", "r31", "cc", "memory" \
+)
+
+#if WS2811_PIXEL_BYTES == 3
+/*
+ * Same as WS2811_OUT_1 but the pixels are given as 8-bit indices into
+ * PAL, a palette of up to 256 RGB_t colours in RAM, expanded as they are
+ * output, so the frame takes a third of the memory.  The loop is unrolled
+ * for the three bytes of a pixel so that each 8th bit can do its share of
+ * the next pixel's lookup.  Uses mul, which isn't available on the ATtinys.
+ * There is no 2-strip version as WS2811_OUT_2's 8th bit has no spare
+ * cycles for the lookups and unrolling all 24 bits to use the spare ones
+ * of the other bits would take about 1KB per pin pair.
+ * r18 = byte to be output
+ * r19 = next pixel's index
+ * r20 = palette entry size
+ * r30:r31 = current colour's next byte
+ * r0:r1 = next colour's offset, r1 is cleared again at the end
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_1_PAL8(PORT, PIN, IDX, LEN, PAL) \
+asm volatile( \
+/* initialise */ \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
+"    ldi r20, 3           ; palette entry size\n" \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    sbiw %A[len], 1      ; count the first pixel\n" \
+"    brge 8f\n" \
+"    rjmp 9f              ; nothing to output\n" \
+"8:  ld r19, %a[idx]+     ; look up the first pixel's colour\n" \
+"    mul r19, r20\n" \
+"    movw r30, %A[pal]\n" \
+"    add r30, r0\n" \
+"    adc r31, r1\n" \
+"    ld r18, Z+           ; load its first byte\n" \
+"    cli\n" \
+/* 1st byte of a pixel, loop over the first 7 bits */ \
+"7:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 7b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  ld r18, Z+           ; load the next byte of the colour\n" \
+"    sbiw %A[len], 1      ; count the next pixel, set flags\n" \
+"    brlt 8f              ; last pixel, don't load beyond the end\n" \
+"    ld r19, %a[idx]+     ; load the next pixel's index\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 1f\n" \
+"8:  rjmp 4b              ; equalise delay of both code paths\n" \
+/* 2nd byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  ld r18, Z+           ; load the next byte of the colour\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    mul r19, r20         ; offset of the next pixel's colour\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    nop\n" \
+"    nop\n" \
+/* 3rd byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  movw r30, %A[pal]    ; point Z at the next pixel's colour\n" \
+"    add r30, r0\n" \
+"    adc r31, r1\n" \
+"    ld r18, Z+           ; load its first byte\n" \
+"    sbrc %B[len], 7      ; all pixels done?\n" \
+"    rjmp 9f\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 7b              ; (outer) loop\n" \
+"9:\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+"    clr __zero_reg__\n" \
+: \
+: [idx] "e" (IDX), \
+  [len] "w" (LEN), \
+  [pal] "r" (PAL), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN) \
+: "r16", "r17", "r18", "r19", "r20", "r30", "r31", "cc", "memory" \
+)
+
+/*
+ * Same as WS2811_OUT_1_PAL8 but with 4-bit indices into a palette of up
+ * to 16 colours, two pixels per byte with the first one in the high
+ * nibble, so the frame takes a sixth of the memory of the RGB_t pixels.
+ * r18 = byte to be output
+ * r19 = next pixel's index
+ * r20 = palette entry size
+ * r21 = current pair of indices
+ * r30:r31 = current colour's next byte
+ * r0:r1 = next colour's offset, r1 is cleared again at the end
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_1_PAL4(PORT, PIN, IDX, LEN, PAL) \
+asm volatile( \
+/* initialise */ \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
+"    ldi r20, 3           ; palette entry size\n" \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    sbiw %A[len], 1      ; count the first pixel\n" \
+"    brge 8f\n" \
+"    rjmp 9f              ; nothing to output\n" \
+"8:  ld r21, %a[idx]+     ; look up the first pixel's colour\n" \
+"    mov r19, r21\n" \
+"    swap r19\n" \
+"    andi r19, 0x0f\n" \
+"    mul r19, r20\n" \
+"    movw r30, %A[pal]\n" \
+"    add r30, r0\n" \
+"    adc r31, r1\n" \
+"    ld r18, Z+           ; load its first byte\n" \
+"    cli\n" \
+/* even pixel, 1st byte, loop over the first 7 bits */ \
+"7:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 7b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  ld r18, Z+           ; load the next byte of the colour\n" \
+"    sbiw %A[len], 1      ; count the next pixel, set flags\n" \
+"    brlt 8f              ; last pixel, don't load beyond the end\n" \
+"    mov r19, r21         ; the next pixel's index is in the low nibble\n" \
+"    nop\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 1f\n" \
+"8:  rjmp 4b              ; equalise delay of both code paths\n" \
+/* 2nd byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  ld r18, Z+           ; load the next byte of the colour\n" \
+"    andi r19, 0x0f\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    mul r19, r20         ; offset of the next pixel's colour\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    nop\n" \
+"    nop\n" \
+/* 3rd byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  movw r30, %A[pal]    ; point Z at the next pixel's colour\n" \
+"    add r30, r0\n" \
+"    adc r31, r1\n" \
+"    ld r18, Z+           ; load its first byte\n" \
+"    sbrc %B[len], 7      ; all pixels done?\n" \
+"    rjmp 9f\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    nop\n" \
+"    nop\n" \
+/* odd pixel, 1st byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  ld r18, Z+           ; load the next byte of the colour\n" \
+"    sbiw %A[len], 1      ; count the next pixel, set flags\n" \
+"    brlt 8f              ; last pixel, don't load beyond the end\n" \
+"    ld r21, %a[idx]+     ; load the next two indices\n" \
+"    mov r19, r21\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 1f\n" \
+"8:  rjmp 4b              ; equalise delay of both code paths\n" \
+/* 2nd byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  ld r18, Z+           ; load the next byte of the colour\n" \
+"    swap r19             ; the next pixel's index is in the high nibble\n" \
+"    andi r19, 0x0f\n" \
+"    nop\n" \
+"    nop\n" \
+"    mul r19, r20         ; offset of the next pixel's colour\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    nop\n" \
+"    nop\n" \
+/* 3rd byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  movw r30, %A[pal]    ; point Z at the next pixel's colour\n" \
+"    add r30, r0\n" \
+"    adc r31, r1\n" \
+"    ld r18, Z+           ; load its first byte\n" \
+"    sbrc %B[len], 7      ; all pixels done?\n" \
+"    rjmp 9f\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 7b              ; (outer) loop\n" \
+"9:\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+"    clr __zero_reg__\n" \
+: \
+: [idx] "e" (IDX), \
+  [len] "w" (LEN), \
+  [pal] "r" (PAL), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN) \
+: "r16", "r17", "r18", "r19", "r20", "r21", \
+  "r30", "r31", "cc", "memory" \
+)
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+/*
+ * Same as WS2811_OUT_1 but reading the pixels from flash, e.g. a PROGMEM
+ * array, with lpm, which takes one of the 8th bit's spare cycles more
+ * than ld.  Flash data has to be in the first 64KB.
+ * r18 = byte to be output
+ * r18:r19 = temp value
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_1_P(PORT, PIN, RGB, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]    ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    rjmp 6f             ; start with the end-of-loop check\n" \
+/* loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 4f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"4:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 5f\n" \
+"5:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"6:  sbiw %A[len], 1      ; decrement outer loop counter, set flags\n" \
+"    brlt 7f              ; no more bytes, don't load beyond the end\n" \
+"    lpm r18, Z+          ; load next byte\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 1b              ; (outer) loop\n" \
+"7:  nop                  ; equalise delay of both code paths\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+: \
+: [rgb] "z" (RGB), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN) \
+: "r16", "r17", "r18", "r19", "cc", "memory" \
+)
+
+#if WS2811_PIXEL_BYTES == 3
+/*
+ * Same as WS2811_OUT_1_P but the pixels are run-length encoded: DATA
+ * points to runs of identical pixels in flash, each a byte with the
+ * number of pixels minus 1 (so 1 to 256 pixels) followed by the G, R and
+ * B bytes of their colour.  The runs are expanded as the pixels are
+ * output until LEN pixels have been sent, with the run counting spread
+ * over the three 8th bits of every pixel, so the output is as fast as
+ * with the raw pixels.  Instead of branching, the pointer is moved back
+ * to the run's colour or on to the next run by adding 0 or 4.  The next
+ * run's length is read a pixel ahead, so if the last run ends exactly at
+ * the LEN'th pixel the 2 bytes following it are also read.  See
+ * WS2811_rle_encode() for a host-side encoder.  Flash data has to be in
+ * the first 64KB.
+ * r18 = byte to be output
+ * r19 = pixels left in the current run after the current one
+ * r20 = 4 if the current pixel is the last of its run, 0 otherwise
+ * r21 = next run's length
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_1_RLE(PORT, PIN, DATA, LEN) \
+asm volatile( \
+/* initialise */ \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    ldi r20, 4           ; the first pixel starts a run\n" \
+"    lpm r21, Z+          ; load the first run's length\n" \
+"    lpm r18, Z+          ; load its G byte\n" \
+"    sbiw %A[len], 1      ; count the first pixel\n" \
+"    brge 8f\n" \
+"    rjmp 9f              ; nothing to output\n" \
+"8:  cli\n" \
+/* G byte, loop over the first 7 bits */ \
+"7:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 7b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - load the R byte and count the pixel in its run */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  lpm r18, Z+          ; load the R byte\n" \
+"    sbrc r20, 2          ; first pixel of a run?\n" \
+"    mov r19, r21         ; true, load the run's length\n" \
+"    subi r19, 1          ; count the pixel, set Carry if it's the last\n" \
+"    sbc r20, r20\n" \
+"    andi r20, 4          ; 4 if the next pixel starts a new run\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    nop\n" \
+"    nop\n" \
+/* R byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - load the B byte and move to the next pixel's colour */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  lpm r18, Z+          ; load the B byte\n" \
+"    lpm r21, Z           ; load the next run's length, in case\n" \
+"    sbiw r30, 3          ; back to the run's G byte...\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    add r30, r20         ; ...or on to the next run's\n" \
+"    adc r31, __zero_reg__\n" \
+/* B byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - load the next pixel's G byte */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  lpm r18, Z+          ; load the next pixel's G byte\n" \
+"    sbiw %A[len], 1      ; count the next pixel, set flags\n" \
+"    brlt 9f              ; all pixels done\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 7b              ; (outer) loop\n" \
+"9:  nop                  ; equalise delay of both code paths\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+: \
+: [data] "z" (DATA), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN) \
+: "r16", "r17", "r18", "r19", "r20", "r21", "cc", "memory" \
+)
+
+/*
+ * Output LEN pixels of a linear gradient without a pixel buffer, starting
+ * at FROM (an RGB_t) and adding DG, DR and DB to the G, R and B values
+ * for every pixel.  The increments are 8.8 fixed point, i.e. 256 is 1 per
+ * pixel, two's complement for decreasing values, see
+ * WS2811_OUT_1_GRADIENT and WS2811_OUT_1_FILL below for the usual cases.
+ * LEN isn't limited by the RAM so this can also blank or fill strips
+ * longer than any buffer would fit.  The loop is unrolled for the three
+ * bytes of a pixel and each 8th bit steps one of the colours.  With
+ * another WS2811_ORDER, G, R and B below stand for the colours in output
+ * order, WS2811_C0 to WS2811_C2.
+ * r18 = byte to be output
+ * r20:r21 = G value, 8.8 fixed point
+ * r22:r23 = R value
+ * r24:r25 = B value
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_1_RAMP(PORT, PIN, FROM, DG, DR, DB, LEN) \
+asm volatile( \
+/* initialise */ \
+"    in r16, __SREG__     ; timing-critical, so no interrupts\n" \
+"    ldi r17, 7           ; load inner loop counter\n" \
+"    ldi r20, 0x80        ; start from the middle of each value to round\n" \
+"    mov r21, %[g]\n" \
+"    ldi r22, 0x80\n" \
+"    mov r23, %[r]\n" \
+"    ldi r24, 0x80\n" \
+"    mov r25, %[b]\n" \
+"    mov r18, r21         ; first G byte\n" \
+"    sbiw %A[len], 1      ; count the first pixel\n" \
+"    brge 8f\n" \
+"    rjmp 9f              ; nothing to output\n" \
+"8:  cli\n" \
+/* G byte, loop over the first 7 bits */ \
+"7:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 7b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - step G */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  mov r18, r23         ; R byte next\n" \
+"    add r20, %A[dg]      ; step G\n" \
+"    adc r21, %B[dg]\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    nop\n" \
+"    nop\n" \
+/* R byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - step R */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  mov r18, r25         ; B byte next\n" \
+"    add r22, %A[dr]      ; step R\n" \
+"    adc r23, %B[dr]\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    nop\n" \
+"    nop\n" \
+/* B byte, loop over the first 7 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    sbi  %[port], %[pin] ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 2f              ; true, skip pin hi -> lo\n" \
+"    cbi  %[port], %[pin] ; false, pin hi -> lo\n" \
+"2:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 3f\n" \
+"3:  nop                  ; pulse timing delay\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18              ; shift to next bit\n" \
+"    dec r17              ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    brne 1b              ; (inner) loop if required\n" \
+"    ldi r17, 7           ; reload inner loop counter\n" \
+/* 8th bit - step B and count the pixel */ \
+WS2811_PAD_HI \
+"    sbi %[port], %[pin]  ; pin lo -> hi\n" \
+WS2811_PAD_DATA \
+"    sbrc r18, 7          ; test hi bit clear\n" \
+"    rjmp 5f              ; true, skip pin hi -> lo\n" \
+"    cbi %[port], %[pin]  ; false, pin hi -> lo\n" \
+"5:  sbrc r18, 7          ; equalise delay of both code paths\n" \
+"    rjmp 6f\n" \
+"6:  add r24, %A[db]      ; step B\n" \
+"    adc r25, %B[db]\n" \
+"    mov r18, r21         ; next pixel's G byte\n" \
+"    sbiw %A[len], 1      ; count the next pixel, set flags\n" \
+"    brlt 9f              ; all pixels done\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    rjmp 7b              ; (outer) loop\n" \
+"9:  nop                  ; equalise delay of both code paths\n" \
+WS2811_PAD_LO \
+"    cbi %[port], %[pin]  ; pin hi -> lo\n" \
+"    out __SREG__, r16    ; reenable interrupts if required\n" \
+: \
+: [g] "r" ((FROM).WS2811_C0), \
+  [r] "r" ((FROM).WS2811_C1), \
+  [b] "r" ((FROM).WS2811_C2), \
+  [dg] "r" (WS2811_PICK(WS2811_C0, DG, DR, DB)), \
+  [dr] "r" (WS2811_PICK(WS2811_C1, DG, DR, DB)), \
+  [db] "r" (WS2811_PICK(WS2811_C2, DG, DR, DB)), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN) \
+: "r16", "r17", "r18", "r20", "r21", "r22", "r23", "r24", "r25", \
+  "cc", "memory" \
+)
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+/*
+ * Same as WS2811_OUT_2 but reading the pixels from flash with lpm.  Only
+ * Z can be used with lpm so the two streams come interleaved byte by byte
+ * from a single array, i.e. stream 0's first G byte, stream 1's first G
+ * byte, then the R bytes and so on, 6 bytes per pixel.  The two lpms
+ * don't fit in the 8th bit, so like in WS2811_OUT_2_SCALE the 7th bit is
+ * taken out of the inner loop too and the next bytes are loaded there,
+ * into r12 and r13 as the current bytes' 8th bits are still needed.
+ * Flash data has to be in the first 64KB.
+ * r14 = stream 0 byte to be output
+ * r15 = stream 1 byte to be output
+ * r12:r13 = next stream 0 and 1 bytes
+ * r18 = port 0 original value with stream 0 pin low
+ * r19 = port 1 original value with stream 1 pin low
+ * r20 = port 0 original value with stream 0 pin high
+ * r21 = port 1 original value with stream 1 pin high
+ * r22 = port 0 original value with stream 0 pin set to the next output bit
+ * r23 = port 1 original value with stream 1 pin set to the next output bit
+ * r18:r19 = temp value
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_2_P(PORT0, PIN0, PORT1, PIN1, DATA, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    in r18, %[port0]\n" \
+"    in r19, %[port1]\n" \
+"    movw r20, r18\n" \
+"    sbr r20, 1 << %[pin0]\n" \
+"    sbr r21, 1 << %[pin1]\n" \
+"    movw r22, r18\n" \
+"    ldi r17, 6             ; load inner loop counter\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 5f               ; nothing to output\n" \
+/* last byte - finish the 7th bit without loading */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    rjmp 4f\n" \
+"2:  lpm r14, Z+            ; load first stream 0 byte\n" \
+"    lpm r15, Z+            ; load first stream 1 byte\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    cli\n" \
+/* loop over the first 6 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r14                ; shift stream 0 byte to next bit, set Carry\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    lsl r15                ; shift stream 1 byte to next bit, set Carry\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    dec r17                ; decrement loop counter, set flags\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r17, 6             ; reload inner loop counter\n" \
+/* 7th bit - fetch next values */ \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    bst r14, 6\n" \
+"    bld r22, %[pin0]       ; load r14 bit 6 into pin0\n" \
+"    brlt 3b                ; no more bytes, don't load beyond the end\n" \
+"    lpm r12, Z+            ; load next stream 0 byte\n" \
+"    lpm r13, Z+            ; load next stream 1 byte\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    bst r15, 6\n" \
+"    bld r23, %[pin1]       ; load r15 bit 6 into pin1\n" \
+/* 8th bit - move the next values in */ \
+WS2811_PAD_HI \
+"    out %[port0], r20      ; pin0 lo -> hi\n" \
+"    out %[port1], r21      ; pin1 lo -> hi\n" \
+"    movw r14, r12\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r22      ; pin0 hi -> colour output bit\n" \
+"    out %[port1], r23      ; pin1 hi -> colour output bit\n" \
+"    bst r14, 7\n" \
+"    bld r22, %[pin0]       ; load r14 bit 7 into pin0\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin1]       ; load r15 bit 7 into pin1\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    brlt 6f                ; all bytes done\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+"6:\n" \
+WS2811_PAD_LO \
+"    out %[port0], r18      ; pin0 hi -> lo if not already low\n" \
+"    out %[port1], r19      ; pin1 hi -> lo if not already low\n" \
+"5:  out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [data] "z" (DATA), \
+  [len] "w" (LEN), \
+  [port0] "I" (_SFR_IO_ADDR(PORT0)), \
+  [port1] "I" (_SFR_IO_ADDR(PORT1)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1) \
+: "r12", "r13", "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r21", \
+  "r22", "r23", "cc", "memory" \
+)
+
+/*
+ * Inline asm macro to output two streams of 24-bit GRB values in
+ * (G,R,B) order, MSBit first.  The two output pins must be on the same
+ * atmega port, which WS2811_OUT_2 can't handle as it writes the ports
+ * one after the other.  Same as WS2811_OUT_3_COMMON below with one
+ * stream less.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ * r18 = stream 0 byte to be output
+ * r19 = stream 1 byte to be output
+ * r21 = original port value with both pins low
+ * r22 = original port value with both pins high
+ * r23 = original port value with the 2 pins set to their next output values
+ * r24 = (+r25) outer loop counter
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ */
+#define WS2811_OUT_2_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r24, %[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("r24", "r25", "%A[len]", "%B[len]") \
+"    in r21, %[port]\n" \
+"    mov r22, r21\n" \
+"    sbr r22, (1 << %[pin0]) | (1 << %[pin1])\n" \
+"    mov r23, r21\n" \
+"    ldi r17, 6             ; load inner loop counter\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    brge 6f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"6:  ld r18, %a[rgb0]+      ; load first stream 0 byte\n" \
+"    ld r19, %a[rgb1]+      ; load first stream 1 byte\n" \
+"    rjmp 2f                ; start with the first bit values\n" \
+/* last byte - finish the 7th bit without loading, then the 8th bit */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    rjmp 5f\n" \
+/* loop over the first 6 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18                ; shift stream 0 byte to next bit, set Carry\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin0]       ; load r18 bit 7 into pin0\n" \
+"    lsl r19                ; shift stream 1 byte to next bit, set Carry\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin1]       ; load r19 bit 7 into pin1\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    dec r17                ; decrement loop counter, set flags\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r17, 6             ; reload inner loop counter\n" \
+/* 7th bit - output & fetch next values if any */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    bst r18, 6\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    bld r23, %[pin0]       ; load r18 bit 6 into pin0\n" \
+"    bst r19, 6\n" \
+"    bld r23, %[pin1]       ; load r19 bit 6 into pin1\n" \
+"    brlt 3b                ; no more bytes, don't load beyond the end\n" \
+"    ld r18, %a[rgb0]+      ; load next stream 0 byte\n" \
+"    ld r19, %a[rgb1]+      ; load next stream 1 byte\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+/* 8th bit - output */ \
+"5:\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"2:  bst r18, 7\n" \
+"    bld r23, %[pin0]       ; load r18 bit 7 into pin0\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin1]       ; load r19 bit 7 into pin1\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    brlt 7f                ; all bytes done\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+"7:\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"4:  out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [rgb0] "e" (RGB0), \
+  [rgb1] "e" (RGB1), \
+  [len] "r" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1) \
+: "r16", "r17", "r18", "r19", "r21", "r22", "r23", "r24", "r25", \
+  "cc", "memory" \
+)
+
+/*
+ * Inline asm macro to output three streams of 24-bit GRB values in
+ * (G,R,B) order, MSBit first.  The three output pins must be on the same
+ * atmega port.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ * r18 = stream 0 byte to be output
+ * r19 = stream 1 byte to be output
+ * r20 = stream 2 byte to be output
+ * r21 = original port value with all three pins low
+ * r22 = original port value with all three pins high
+ * r23 = original port value with the 3 pins set to their next output values
+ * r24 = (+r25) outer loop counter
+ * r16 = saved SREG
+ * r17 = inner loop counter
+ *
+ * The last two bits of each byte are unrolled so that the end-of-stream
+ * check can be done before loading the next bytes, in the 7th bit, and
+ * nothing is read beyond the end of the streams.
+ *
+ * NOTE: if you need 4 or more parallel outputs you're probably better off
+ * with the approach where the output bits are pre-grouped into atmega port
+ * values, see WS2811_OUT_8_PACKED below.
+ */
+#define WS2811_OUT_3_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r24, %[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("r24", "r25", "%A[len]", "%B[len]") \
+"    in r21, %[port]\n" \
+"    mov r22, r21\n" \
+"    sbr r22, (1 << %[pin0]) | (1 << %[pin1]) | (1 << %[pin2])\n" \
+"    mov r23, r21\n" \
+"    ldi r17, 6             ; load inner loop counter\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    brge 6f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"6:  ld r18, %a[rgb0]+      ; load first stream 0 byte\n" \
+"    ld r19, %a[rgb1]+      ; load first stream 1 byte\n" \
+"    ld r20, %a[rgb2]+      ; load first stream 2 byte\n" \
+"    rjmp 2f                ; start with the first bit values\n" \
+/* last byte - finish the 7th bit without loading, then the 8th bit */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    rjmp 5f\n" \
+/* loop over the first 6 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r18                ; shift stream 0 byte to next bit, set Carry\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin0]       ; load r18 bit 7 into pin0\n" \
+"    lsl r19                ; shift stream 1 byte to next bit, set Carry\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin1]       ; load r19 bit 7 into pin1\n" \
+"    lsl r20                ; shift stream 2 byte to next bit, set Carry\n" \
+"    bst r20, 7\n" \
+"    bld r23, %[pin2]       ; load r20 bit 7 into pin2\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    dec r17                ; decrement loop counter, set flags\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r17, 6             ; reload inner loop counter\n" \
+/* 7th bit - output & fetch next values if any */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    bst r18, 6\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    bld r23, %[pin0]       ; load r18 bit 6 into pin0\n" \
+"    bst r19, 6\n" \
+"    bld r23, %[pin1]       ; load r19 bit 6 into pin1\n" \
+"    bst r20, 6\n" \
+"    bld r23, %[pin2]       ; load r20 bit 6 into pin2\n" \
+"    brlt 3b                ; no more bytes, don't load beyond the end\n" \
+"    ld r18, %a[rgb0]+      ; load next stream 0 byte\n" \
+"    ld r19, %a[rgb1]+      ; load next stream 1 byte\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    ld r20, %a[rgb2]+      ; load next stream 2 byte\n" \
+"    nop\n" \
+/* 8th bit - output */ \
+"5:\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"2:  bst r18, 7\n" \
+"    bld r23, %[pin0]       ; load r18 bit 7 into pin0\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin1]       ; load r19 bit 7 into pin1\n" \
+"    bst r20, 7\n" \
+"    bld r23, %[pin2]       ; load r20 bit 7 into pin2\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    brlt 7f                ; all bytes done\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+"7:\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"4:  out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [rgb0] "e" (RGB0), \
+  [rgb1] "e" (RGB1), \
+  [rgb2] "e" (RGB2), \
+  [len] "r" (LEN), /* For some reason we can't use "w" here to get r24 */ \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1), \
+  [pin2] "I" (PIN2) \
+: "r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23", "r24", "r25", \
+  "cc", "memory" \
+)
+
+/*
+ * Inline asm macro to output four streams of 24-bit GRB values in
  * (G,R,B) order, MSBit first.  The four output pins must be on the same
  * atmega port.
  * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
- * r17 = stream 0 byte to be output
- * r18 = stream 1 byte to be output
- * r19 = stream 2 byte to be output
- * r20 = stream 3 byte to be output
- * r21 = original port value with all three pins low
- * r22 = original port value with all three pins high
- * r23 = original port value with the 4 pins set to their next output values
- * r24 = (+r25) outer loop counter
- * r15 = saved SREG
- * r16 = inner loop counter
+ * r17 = stream 0 byte to be output
+ * r18 = stream 1 byte to be output
+ * r19 = stream 2 byte to be output
+ * r20 = stream 3 byte to be output
+ * r21 = original port value with all three pins low
+ * r22 = original port value with all three pins high
+ * r23 = original port value with the 4 pins set to their next output values
+ * r24 = (+r25) outer loop counter
+ * r15 = saved SREG
+ * r16 = inner loop counter
+ */
+#define WS2811_OUT_4_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, PIN3, RGB3, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r24, %[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("r24", "r25", "%A[len]", "%B[len]") \
+"    in r21, %[port]\n" \
+"    mov r22, r21\n" \
+"    sbr r22, (1 << %[pin0]) | (1 << %[pin1]) | (1 << %[pin2]) | (1 << %[pin3])\n" \
+"    mov r23, r21\n" \
+"    ldi r16, 6             ; load inner loop counter\n" \
+"    in r15, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    brge 6f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"6:  movw r26, %[rgb0]\n" \
+"    ld r17, X+             ; load first stream 0 byte\n" \
+"    movw %[rgb0], r26\n" \
+"    movw r26, %[rgb1]\n" \
+"    ld r18, X+             ; load first stream 1 byte\n" \
+"    movw %[rgb1], r26\n" \
+"    ld r19, %a[rgb2]+      ; load first stream 2 byte\n" \
+"    ld r20, %a[rgb3]+      ; load first stream 3 byte\n" \
+"    rjmp 2f                ; start with the first bit values\n" \
+/* loop over the first 6 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r17                ; shift stream 0 byte to next bit, set Carry\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    bst r17, 7\n" \
+"    bld r23, %[pin0]       ; load r17 bit 7 into pin0\n" \
+"    lsl r18                ; shift stream 1 byte to next bit, set Carry\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin1]       ; load r18 bit 7 into pin1\n" \
+"    lsl r19                ; shift stream 2 byte to next bit, set Carry\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin2]       ; load r19 bit 7 into pin2\n" \
+"    lsl r20                ; shift stream 3 byte to next bit, set Carry\n" \
+"    bst r20, 7\n" \
+"    bld r23, %[pin3]       ; load r20 bit 7 into pin3\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    dec r16                ; decrement loop counter, set flags\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r16, 6             ; reload inner loop counter\n" \
+/* 7th bit - output & fetch next values if any */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    bst r17, 6\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    bld r23, %[pin0]       ; load r17 bit 6 into pin0\n" \
+"    bst r18, 6\n" \
+"    bld r23, %[pin1]       ; load r18 bit 6 into pin1\n" \
+"    bst r19, 6\n" \
+"    bld r23, %[pin2]       ; load r19 bit 6 into pin2\n" \
+"    bst r20, 6\n" \
+"    bld r23, %[pin3]       ; load r20 bit 6 into pin3\n" \
+"    brlt 3f                ; no more bytes, don't load beyond the end\n" \
+"    movw r26, %[rgb0]\n" \
+"    ld r17, X+             ; load next stream 0 byte\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    movw %[rgb0], r26\n" \
+"    movw r26, %[rgb1]\n" \
+"    nop\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    ld r18, X+             ; load next stream 1 byte\n" \
+"    movw %[rgb1], r26\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    ld r19, %a[rgb2]+      ; load next stream 2 byte\n" \
+"    ld r20, %a[rgb3]+      ; load next stream 3 byte\n" \
+"2:  bst r17, 7\n" \
+"    bld r23, %[pin0]       ; load r17 bit 7 into pin0\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin1]       ; load r18 bit 7 into pin1\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin2]       ; load r19 bit 7 into pin2\n" \
+"    bst r20, 7\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin3]       ; load r20 bit 7 into pin3\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+/* last byte - finish the 7th and 8th bits without loading and return */ \
+"3:  nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    ldi r16, 3\n" \
+"5:  dec r16\n" \
+"    brne 5b\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"4:  out __SREG__, r15      ; reenable interrupts if required\n" \
+: \
+: [rgb0] "r" (RGB0), \
+  [rgb1] "r" (RGB1), \
+  [rgb2] "e" (RGB2), \
+  [rgb3] "e" (RGB3), \
+  [len] "r" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1), \
+  [pin2] "I" (PIN2), \
+  [pin3] "I" (PIN3) \
+: "r15", "r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23", \
+  "r24", "r25", "r26", "r27", \
+  "cc", "memory" \
+)
+
+/*
+ * Same as WS2811_OUT_4_COMMON but reading the pixels from flash with lpm.
+ * Only Z can be used with lpm so the four streams come interleaved byte by
+ * byte from a single array, i.e. the G bytes of the 4 strips' first pixels,
+ * then the R bytes, and so on, 12 bytes per pixel.  The lpms fit in the
+ * cycles WS2811_OUT_4_COMMON spends juggling its pointers.  Flash data has
+ * to be in the first 64KB.
+ */
+#define WS2811_OUT_4_COMMON_P(PORT, PIN0, PIN1, PIN2, PIN3, DATA, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r24, %[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("r24", "r25", "%A[len]", "%B[len]") \
+"    in r21, %[port]\n" \
+"    mov r22, r21\n" \
+"    sbr r22, (1 << %[pin0]) | (1 << %[pin1]) | (1 << %[pin2]) | (1 << %[pin3])\n" \
+"    mov r23, r21\n" \
+"    ldi r16, 6             ; load inner loop counter\n" \
+"    in r15, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    brge 6f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"6:  lpm r17, Z+            ; load first stream 0 byte\n" \
+"    lpm r18, Z+            ; load first stream 1 byte\n" \
+"    lpm r19, Z+            ; load first stream 2 byte\n" \
+"    lpm r20, Z+            ; load first stream 3 byte\n" \
+"    rjmp 2f                ; start with the first bit values\n" \
+/* loop over the first 6 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    lsl r17                ; shift stream 0 byte to next bit, set Carry\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    bst r17, 7\n" \
+"    bld r23, %[pin0]       ; load r17 bit 7 into pin0\n" \
+"    lsl r18                ; shift stream 1 byte to next bit, set Carry\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin1]       ; load r18 bit 7 into pin1\n" \
+"    lsl r19                ; shift stream 2 byte to next bit, set Carry\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin2]       ; load r19 bit 7 into pin2\n" \
+"    lsl r20                ; shift stream 3 byte to next bit, set Carry\n" \
+"    bst r20, 7\n" \
+"    bld r23, %[pin3]       ; load r20 bit 7 into pin3\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    dec r16                ; decrement loop counter, set flags\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r16, 6             ; reload inner loop counter\n" \
+/* 7th bit - output & fetch next values if any */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    bst r17, 6\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    bld r23, %[pin0]       ; load r17 bit 6 into pin0\n" \
+"    bst r18, 6\n" \
+"    bld r23, %[pin1]       ; load r18 bit 6 into pin1\n" \
+"    bst r19, 6\n" \
+"    bld r23, %[pin2]       ; load r19 bit 6 into pin2\n" \
+"    bst r20, 6\n" \
+"    bld r23, %[pin3]       ; load r20 bit 6 into pin3\n" \
+"    brlt 3f                ; no more bytes, don't load beyond the end\n" \
+"    lpm r17, Z+            ; load next stream 0 byte\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    lpm r18, Z+            ; load next stream 1 byte\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    lpm r19, Z+            ; load next stream 2 byte\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    lpm r20, Z+            ; load next stream 3 byte\n" \
+"    nop\n" \
+"2:  bst r17, 7\n" \
+"    bld r23, %[pin0]       ; load r17 bit 7 into pin0\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin1]       ; load r18 bit 7 into pin1\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin2]       ; load r19 bit 7 into pin2\n" \
+"    bst r20, 7\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin3]       ; load r20 bit 7 into pin3\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+/* last byte - finish the 7th and 8th bits without loading and return */ \
+"3:  nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    ldi r16, 3\n" \
+"5:  dec r16\n" \
+"    brne 5b\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"4:  out __SREG__, r15      ; reenable interrupts if required\n" \
+: \
+: [data] "z" (DATA), \
+  [len] "r" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1), \
+  [pin2] "I" (PIN2), \
+  [pin3] "I" (PIN3) \
+: "r15", "r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23", \
+  "r24", "r25", "cc", "memory" \
+)
+
+/*
+ * Same as WS2811_OUT_4_COMMON but with the pins given as bit masks at run
+ * time instead of as constants, so one copy of the code, e.g. a function
+ * defined with DEFINE_WS2811_OUT_4_MASK_FN, serves every combination of
+ * up to four pins of PORT.  MASKn has the bit of stream n's pin set, e.g.
+ * 1 << 3 for PC3, and the masks must not overlap.  A mask with more than
+ * one bit drives the same stream on several pins and a mask of 0 leaves
+ * the stream unused, its pointer is still read from so it can be set to
+ * any of the other streams'.
+ * The bits are set with sbrc and or instead of bst and bld, which takes
+ * the same 2 cycles, but the next port value has to be reset to r21
+ * first, one more cycle per bit.  The inner loop covers 5 bits, which
+ * frees the cycles for that in the 6th to 8th bits, so the timing is
+ * exactly that of WS2811_OUT_4_COMMON.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ * r17 = stream 0 byte to be output
+ * r18 = stream 1 byte to be output
+ * r19 = stream 2 byte to be output
+ * r20 = stream 3 byte to be output
+ * r21 = original port value with all the pins low
+ * r22 = original port value with all the pins high
+ * r23 = original port value with the pins set to their next output values
+ * r24 = (+r25) outer loop counter
+ * r14 = next stream 0 byte
+ * r15 = saved SREG
+ * r16 = inner loop counter
+ */
+#define WS2811_OUT_4_MASK(PORT, MASK0, RGB0, MASK1, RGB1, MASK2, RGB2, MASK3, RGB3, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r24, %[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("r24", "r25", "%A[len]", "%B[len]") \
+"    mov r22, %[mask0]\n" \
+"    or r22, %[mask1]\n" \
+"    or r22, %[mask2]\n" \
+"    or r22, %[mask3]       ; all the pins\n" \
+"    mov r23, r22\n" \
+"    com r23\n" \
+"    in r21, %[port]\n" \
+"    and r21, r23\n" \
+"    or r22, r21\n" \
+"    ldi r16, 5             ; load inner loop counter\n" \
+"    in r15, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    brge 6f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"6:  movw r26, %[rgb0]\n" \
+"    ld r17, X+             ; load first stream 0 byte\n" \
+"    movw %[rgb0], r26\n" \
+"    movw r26, %[rgb1]\n" \
+"    ld r18, X+             ; load first stream 1 byte\n" \
+"    movw %[rgb1], r26\n" \
+"    ld r19, %a[rgb2]+      ; load first stream 2 byte\n" \
+"    ld r20, %a[rgb3]+      ; load first stream 3 byte\n" \
+"    rjmp 2f                ; start with the first bit values\n" \
+/* loop over the first 5 bits */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    lsl r17                ; shift stream 0 byte to next bit\n" \
+"    lsl r18                ; shift stream 1 byte to next bit\n" \
+"    lsl r19                ; shift stream 2 byte to next bit\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    mov r23, r21\n" \
+"    sbrc r17, 7\n" \
+"    or r23, %[mask0]       ; load r17 bit 7 into the mask0 pins\n" \
+"    sbrc r18, 7\n" \
+"    or r23, %[mask1]       ; load r18 bit 7 into the mask1 pins\n" \
+"    sbrc r19, 7\n" \
+"    or r23, %[mask2]       ; load r19 bit 7 into the mask2 pins\n" \
+"    lsl r20                ; shift stream 3 byte to next bit\n" \
+"    sbrc r20, 7\n" \
+"    or r23, %[mask3]       ; load r20 bit 7 into the mask3 pins\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    dec r16                ; decrement loop counter, set flags\n" \
+"    brne 1b                ; (inner) loop if required\n" \
+"    ldi r16, 5             ; reload inner loop counter\n" \
+/* 6th bit - output & count the byte */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    brlt 3f                ; no more bytes, don't load beyond the end\n" \
+"    mov r23, r21\n" \
+"    sbrc r17, 6\n" \
+"    or r23, %[mask0]       ; load r17 bit 6 into the mask0 pins\n" \
+"    sbrc r18, 6\n" \
+"    or r23, %[mask1]       ; load r18 bit 6 into the mask1 pins\n" \
+"    sbrc r19, 6\n" \
+"    or r23, %[mask2]       ; load r19 bit 6 into the mask2 pins\n" \
+"    sbrc r20, 6\n" \
+"    or r23, %[mask3]       ; load r20 bit 6 into the mask3 pins\n" \
+"    movw r26, %[rgb0]\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    ld r14, X+             ; load next stream 0 byte\n" \
+"    movw %[rgb0], r26\n" \
+/* 7th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    movw r26, %[rgb1]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    mov r23, r21\n" \
+"    sbrc r17, 5\n" \
+"    or r23, %[mask0]       ; load r17 bit 5 into the mask0 pins\n" \
+"    sbrc r18, 5\n" \
+"    or r23, %[mask1]       ; load r18 bit 5 into the mask1 pins\n" \
+"    sbrc r19, 5\n" \
+"    or r23, %[mask2]       ; load r19 bit 5 into the mask2 pins\n" \
+"    sbrc r20, 5\n" \
+"    or r23, %[mask3]       ; load r20 bit 5 into the mask3 pins\n" \
+"    ld r20, %a[rgb3]+      ; load next stream 3 byte\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    ld r18, X+             ; load next stream 1 byte\n" \
+"    movw %[rgb1], r26\n" \
+/* 8th bit - output & fetch next values */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    ld r19, %a[rgb2]+      ; load next stream 2 byte\n" \
+"    mov r17, r14\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"2:  mov r23, r21\n" \
+"    sbrc r17, 7\n" \
+"    or r23, %[mask0]       ; load r17 bit 7 into the mask0 pins\n" \
+"    sbrc r18, 7\n" \
+"    or r23, %[mask1]       ; load r18 bit 7 into the mask1 pins\n" \
+"    sbrc r19, 7\n" \
+"    or r23, %[mask2]       ; load r19 bit 7 into the mask2 pins\n" \
+"    sbrc r20, 7\n" \
+"    or r23, %[mask3]       ; load r20 bit 7 into the mask3 pins\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+/* last byte - finish the 6th to 8th bits without loading and return */ \
+"3:  mov r23, r21\n" \
+"    sbrc r17, 6\n" \
+"    or r23, %[mask0]\n" \
+"    sbrc r18, 6\n" \
+"    or r23, %[mask1]\n" \
+"    sbrc r19, 6\n" \
+"    or r23, %[mask2]\n" \
+"    sbrc r20, 6\n" \
+"    or r23, %[mask3]\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    mov r23, r21\n" \
+"    sbrc r17, 5\n" \
+"    or r23, %[mask0]\n" \
+"    sbrc r18, 5\n" \
+"    or r23, %[mask1]\n" \
+"    sbrc r19, 5\n" \
+"    or r23, %[mask2]\n" \
+"    sbrc r20, 5\n" \
+"    or r23, %[mask3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bit\n" \
+"    ldi r16, 3\n" \
+"5:  dec r16\n" \
+"    brne 5b\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pins hi -> lo if not already low\n" \
+"4:  out __SREG__, r15      ; reenable interrupts if required\n" \
+: \
+: [rgb0] "r" (RGB0), \
+  [rgb1] "r" (RGB1), \
+  [rgb2] "e" (RGB2), \
+  [rgb3] "e" (RGB3), \
+  [len] "r" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [mask0] "r" (MASK0), \
+  [mask1] "r" (MASK1), \
+  [mask2] "r" (MASK2), \
+  [mask3] "r" (MASK3) \
+: "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r21", "r22", "r23", \
+  "r24", "r25", "r26", "r27", \
+  "cc", "memory" \
+)
+
+#if WS2811_PIXEL_BYTES == 3
+/*
+ * Inline asm macro to output four streams of 24-bit GRB values in
+ * (G,R,B) order, MSBit first, on two different atmega ports: streams 0
+ * to N - 1 on PORT0 and the rest on PORT1, for N = 2 or 3.  Used through
+ * WS2811_OUT_2_2 and WS2811_OUT_3_1 below.  Both ports are written with
+ * out like in WS2811_OUT_2, PORT1's edges coming 1 cycle after PORT0's,
+ * and the other pins of the ports keep their values.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ *
+ * Six out instructions per bit leave no time for the shifts and the inner
+ * loop of WS2811_OUT_4_COMMON, so the whole pixel is unrolled like in
+ * WS2811_OUT_7_COMMON and each stream bit is moved into its port's value
+ * with a bst/bld pair.  The stream 2 bits go to r18 or r21 depending on
+ * N.  The next pixel's G bytes are loaded while the current pixel's B
+ * bits are output, but on the last pixel r6 is set to 0xff and added to
+ * the stream pointers first, so the current B bytes are read again and
+ * nothing past the end is.
+ * r2 - r5 = stream 0 to 3 G bytes
+ * r6 - r9 = stream 0 to 3 R bytes, then r6 = 0xff on the last pixel, else 0
+ * r10 - r13 = stream 0 to 3 B bytes
+ * r16 = original PORT0 value with its pins low
+ * r17 = original PORT0 value with its pins high
+ * r18 = original PORT0 value with its pins set to their next output values
+ * r19 - r21 = the same for PORT1
+ * r0 = saved SREG
+ */
+#define WS2811_OUT_4_2PORTS(PORT0, PORT1, N, PIN0, RGB0, PIN1, RGB1, \
+        PIN2, RGB2, PIN3, RGB3, LEN) \
+asm volatile( \
+/* initialise */ \
+"    in r16, %[port0]\n" \
+"    cbr r16, %[mask0]\n" \
+"    mov r17, r16\n" \
+"    sbr r17, %[mask0]\n" \
+"    mov r18, r16\n" \
+"    in r19, %[port1]\n" \
+"    cbr r19, %[mask1]\n" \
+"    mov r20, r19\n" \
+"    sbr r20, %[mask1]\n" \
+"    mov r21, r19\n" \
+"    in r0, __SREG__        ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"2:  movw r26, %[rgb0]\n" \
+"    ld r2, X+              ; load stream 0 G byte\n" \
+"    movw %[rgb0], r26\n" \
+"    movw r26, %[rgb1]\n" \
+"    ld r3, X+              ; load stream 1 G byte\n" \
+"    movw %[rgb1], r26\n" \
+"    ld r4, %a[rgb2]+       ; load stream 2 G byte\n" \
+"    ld r5, %a[rgb3]+       ; load stream 3 G byte\n" \
+"    bst r2, 7              ; stream 0 G bit 7\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 7\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 7\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r5, 7\n" \
+"    bld r21, %[pin3]\n" \
+/* G bits - load the R bytes */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    movw r26, %[rgb0]\n" \
+"    ld r6, X+              ; load stream 0 R byte\n" \
+"    movw %[rgb0], r26\n" \
+"    bst r2, 6              ; stream 0 G bit 6\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 6\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 6\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r5, 6\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    movw r26, %[rgb1]\n" \
+"    ld r7, X+              ; load stream 1 R byte\n" \
+"    movw %[rgb1], r26\n" \
+"    bst r2, 5              ; stream 0 G bit 5\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 5\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 5\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r5, 5\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    ld r8, %a[rgb2]+       ; load stream 2 R byte\n" \
+"    bst r2, 4              ; stream 0 G bit 4\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 4\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 4\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r5, 4\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    ld r9, %a[rgb3]+       ; load stream 3 R byte\n" \
+"    bst r2, 3              ; stream 0 G bit 3\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 3\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 3\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r5, 3\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r2, 2              ; stream 0 G bit 2\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 2\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 2\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r5, 2\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r2, 1              ; stream 0 G bit 1\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 1\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 1\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r5, 1\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r2, 0              ; stream 0 G bit 0\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 0\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 0\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r5, 0\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r6, 7              ; stream 0 R bit 7\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 7\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 7\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r9, 7\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+/* R bits - load the B bytes */ \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    movw r26, %[rgb0]\n" \
+"    ld r10, X+             ; load stream 0 B byte\n" \
+"    movw %[rgb0], r26\n" \
+"    bst r6, 6              ; stream 0 R bit 6\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 6\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 6\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r9, 6\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    movw r26, %[rgb1]\n" \
+"    ld r11, X+             ; load stream 1 B byte\n" \
+"    movw %[rgb1], r26\n" \
+"    bst r6, 5              ; stream 0 R bit 5\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 5\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 5\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r9, 5\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    ld r12, %a[rgb2]+      ; load stream 2 B byte\n" \
+"    bst r6, 4              ; stream 0 R bit 4\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 4\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 4\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r9, 4\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    ld r13, %a[rgb3]+      ; load stream 3 B byte\n" \
+"    bst r6, 3              ; stream 0 R bit 3\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 3\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 3\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r9, 3\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r6, 2              ; stream 0 R bit 2\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 2\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 2\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r9, 2\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r6, 1              ; stream 0 R bit 1\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 1\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 1\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r9, 1\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r6, 0              ; stream 0 R bit 0\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r7, 0\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r8, 0\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r9, 0\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r10, 7             ; stream 0 B bit 7\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 7\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 7\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r13, 7\n" \
+"    bld r21, %[pin3]\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+/* B bits - load the next G bytes */ \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r10, 6             ; stream 0 B bit 6\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 6\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 6\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r13, 6\n" \
+"    bld r21, %[pin3]\n" \
+"    sbiw %A[len], 1        ; decrement outer loop counter\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    sbc r6, r6             ; 0xff on the last pixel, else 0\n" \
+"    add %A[rgb0], r6       ; on the last pixel move the pointers\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    adc %B[rgb0], r6\n" \
+"    add %A[rgb1], r6       ; back to the B bytes just loaded\n" \
+"    adc %B[rgb1], r6\n" \
+"    add %A[rgb2], r6\n" \
+"    bst r10, 5             ; stream 0 B bit 5\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 5\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 5\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r13, 5\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    adc %B[rgb2], r6\n" \
+"    add %A[rgb3], r6\n" \
+"    adc %B[rgb3], r6\n" \
+"    tst r6                 ; set flags\n" \
+"    bst r10, 4             ; stream 0 B bit 4\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 4\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 4\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r13, 4\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    movw r26, %[rgb0]\n" \
+"    ld r2, X+              ; load next stream 0 G byte\n" \
+"    movw %[rgb0], r26\n" \
+"    bst r10, 3             ; stream 0 B bit 3\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 3\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 3\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r13, 3\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    movw r26, %[rgb1]\n" \
+"    ld r3, X+              ; load next stream 1 G byte\n" \
+"    movw %[rgb1], r26\n" \
+"    bst r10, 2             ; stream 0 B bit 2\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 2\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 2\n" \
+"    bld r%[n2], %[pin2]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    bst r13, 2\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    ld r4, %a[rgb2]+       ; load next stream 2 G byte\n" \
+"    bst r10, 1             ; stream 0 B bit 1\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 1\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 1\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r13, 1\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    ld r5, %a[rgb3]+       ; load next stream 3 G byte\n" \
+"    bst r10, 0             ; stream 0 B bit 0\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r11, 0\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r12, 0\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r13, 0\n" \
+"    bld r21, %[pin3]\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port0], r17      ; pins lo -> hi\n" \
+"    out %[port1], r20\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; pins hi -> colour output bits\n" \
+"    out %[port1], r21\n" \
+"    bst r2, 7              ; stream 0 G bit 7\n" \
+"    bld r18, %[pin0]\n" \
+"    bst r3, 7\n" \
+"    bld r18, %[pin1]\n" \
+"    bst r4, 7\n" \
+"    bld r%[n2], %[pin2]\n" \
+"    bst r5, 7\n" \
+"    bld r21, %[pin3]\n" \
+"    brlt 3f                ; no more pixels\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"    rjmp 1b                ; (outer) loop\n" \
+/* last pixel - finish the last bit and return */ \
+"3:\n" \
+WS2811_PAD_LO \
+"    out %[port0], r16      ; pins hi -> lo if not already low\n" \
+"    out %[port1], r19\n" \
+"4:  out __SREG__, r0       ; reenable interrupts if required\n" \
+: \
+: [rgb0] "r" (RGB0), \
+  [rgb1] "r" (RGB1), \
+  [rgb2] "e" (RGB2), \
+  [rgb3] "e" (RGB3), \
+  [len] "w" (LEN), \
+  [port0] "I" (_SFR_IO_ADDR(PORT0)), \
+  [port1] "I" (_SFR_IO_ADDR(PORT1)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1), \
+  [pin2] "I" (PIN2), \
+  [pin3] "I" (PIN3), \
+  [n2] "n" ((N) == 3 ? 18 : 21), \
+  [mask0] "M" ((1 << (PIN0)) | (1 << (PIN1)) | \
+          ((N) == 3 ? 1 << (PIN2) : 0)), \
+  [mask1] "M" (((N) == 3 ? 0 : 1 << (PIN2)) | (1 << (PIN3))) \
+: "r0", "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11", \
+  "r12", "r13", "r16", "r17", "r18", "r19", "r20", "r21", "r26", "r27", \
+  "cc", "memory" \
+)
+
+/*
+ * Output two streams on each of two ports, e.g. PB0, PB1 and PC2, PC3,
+ * in the time WS2811_OUT_2 takes for two streams.
+ */
+#define WS2811_OUT_2_2(PORT0, PIN0, RGB0, PIN1, RGB1, \
+        PORT1, PIN2, RGB2, PIN3, RGB3, LEN) \
+    WS2811_OUT_4_2PORTS(PORT0, PORT1, 2, PIN0, RGB0, PIN1, RGB1, \
+            PIN2, RGB2, PIN3, RGB3, LEN)
+
+/* Output three streams on one port and one on another. */
+#define WS2811_OUT_3_1(PORT0, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, \
+        PORT1, PIN3, RGB3, LEN) \
+    WS2811_OUT_4_2PORTS(PORT0, PORT1, 3, PIN0, RGB0, PIN1, RGB1, \
+            PIN2, RGB2, PIN3, RGB3, LEN)
+
+/*
+ * Inline asm macro to output seven streams of 24-bit GRB values in
+ * (G,R,B) order, MSBit first.  The seven output pins must be on the same
+ * atmega port, the remaining pin of that port keeps its value.
+ * The streams are read from a single array of rows of 7 RGB_t values, row
+ * i holding pixel i of the streams 0 to 6, i.e. a RGB_t [LEN][7] array
+ * with pixel i of stream s at RGB[7 * i + s], so no preprocessing is
+ * needed.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ *
+ * The whole pixel is unrolled: with the bit positions known for every
+ * slot each stream bit is moved into the port value with a bst/bld pair
+ * instead of shifting, which leaves the flags and one 2-cycle gap per bit
+ * free for loading the 21 bytes of the next row and for the loop
+ * counter.  The next row's G bytes are loaded while the current row's B
+ * bits are output, but on the last row the row pointer isn't advanced, so
+ * they are the current row's ones and nothing past the end is read.
+ * r2 - r8 = stream 0 to 6 G bytes
+ * r9 - r15 = stream 0 to 6 R bytes
+ * r16 - r22 = stream 0 to 6 B bytes
+ * r23 = original port value with the 7 pins set to their next output values
+ * r24 = (+r25) outer loop counter
+ * r26 = original port value with all seven pins high
+ * r27 = original port value with all seven pins low
+ * r0 = saved SREG
+ */
+#define WS2811_OUT_7_COMMON(PORT, PIN0, PIN1, PIN2, PIN3, PIN4, PIN5, PIN6, \
+        RGB, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r24, %[len]\n" \
+"    in r23, %[port]\n" \
+"    mov r26, r23\n" \
+"    sbr r26, (1 << %[pin0]) | (1 << %[pin1]) | (1 << %[pin2]) | (1 << %[pin3]) | (1 << %[pin4]) | (1 << %[pin5]) | (1 << %[pin6])\n" \
+"    mov r27, r23\n" \
+"    cbr r27, (1 << %[pin0]) | (1 << %[pin1]) | (1 << %[pin2]) | (1 << %[pin3]) | (1 << %[pin4]) | (1 << %[pin5]) | (1 << %[pin6])\n" \
+"    in r0, __SREG__        ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 3f                ; nothing to output\n" \
+"2:  ld r2, Z               ; load stream 0 G byte\n" \
+"    ldd r3, Z+3            ; load stream 1 G byte\n" \
+"    ldd r4, Z+6            ; load stream 2 G byte\n" \
+"    ldd r5, Z+9            ; load stream 3 G byte\n" \
+"    ldd r6, Z+12           ; load stream 4 G byte\n" \
+"    ldd r7, Z+15           ; load stream 5 G byte\n" \
+"    ldd r8, Z+18           ; load stream 6 G byte\n" \
+"    bst r2, 7              ; stream 0 G bit 7\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 7\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 7\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 7\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 7\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 7\n" \
+/* G bits - load the R bytes */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 7\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r9, Z+1            ; load stream 0 R byte\n" \
+"    bst r2, 6              ; stream 0 G bit 6\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 6\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 6\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 6\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 6\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 6\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 6\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r10, Z+4           ; load stream 1 R byte\n" \
+"    bst r2, 5              ; stream 0 G bit 5\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 5\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 5\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 5\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 5\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 5\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 5\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r11, Z+7           ; load stream 2 R byte\n" \
+"    bst r2, 4              ; stream 0 G bit 4\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 4\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 4\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 4\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 4\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 4\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 4\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r12, Z+10          ; load stream 3 R byte\n" \
+"    bst r2, 3              ; stream 0 G bit 3\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 3\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 3\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 3\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 3\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 3\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 3\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r13, Z+13          ; load stream 4 R byte\n" \
+"    bst r2, 2              ; stream 0 G bit 2\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 2\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 2\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 2\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 2\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 2\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 2\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r14, Z+16          ; load stream 5 R byte\n" \
+"    bst r2, 1              ; stream 0 G bit 1\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 1\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 1\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 1\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 1\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 1\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 1\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r15, Z+19          ; load stream 6 R byte\n" \
+"    bst r2, 0              ; stream 0 G bit 0\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 0\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 0\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 0\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 0\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 0\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r8, 0\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r16, Z+2           ; load stream 0 B byte\n" \
+"    bst r9, 7              ; stream 0 R bit 7\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 7\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 7\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 7\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 7\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 7\n" \
+"    nop\n" \
+/* R bits - load the B bytes, move to the next row */ \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 7\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r17, Z+5           ; load stream 1 B byte\n" \
+"    bst r9, 6              ; stream 0 R bit 6\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 6\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 6\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 6\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 6\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 6\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 6\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r18, Z+8           ; load stream 2 B byte\n" \
+"    bst r9, 5              ; stream 0 R bit 5\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 5\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 5\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 5\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 5\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 5\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 5\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r19, Z+11          ; load stream 3 B byte\n" \
+"    bst r9, 4              ; stream 0 R bit 4\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 4\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 4\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 4\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 4\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 4\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 4\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r20, Z+14          ; load stream 4 B byte\n" \
+"    bst r9, 3              ; stream 0 R bit 3\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 3\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 3\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 3\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 3\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 3\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 3\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r21, Z+17          ; load stream 5 B byte\n" \
+"    bst r9, 2              ; stream 0 R bit 2\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 2\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 2\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 2\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 2\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 2\n" \
+"    subi r24, 1            ; decrement outer loop counter\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 2\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r22, Z+20          ; load stream 6 B byte\n" \
+"    bst r9, 1              ; stream 0 R bit 1\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 1\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 1\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 1\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 1\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 1\n" \
+"    sbci r25, 0\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 1\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    sbrs r25, 7            ; advance to the next pixel row, if any\n" \
+"    subi r30, -21\n" \
+"    bst r9, 0              ; stream 0 R bit 0\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r10, 0\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r11, 0\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r12, 0\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r13, 0\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r14, 0\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r15, 0\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    sbrs r25, 7\n" \
+"    sbci r31, -1\n" \
+"    bst r16, 7             ; stream 0 B bit 7\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 7\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 7\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 7\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 7\n" \
+"    nop\n" \
+/* B bits - load the next G bytes */ \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 7\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ld r2, Z               ; load stream 0 next G byte\n" \
+"    bst r16, 6             ; stream 0 B bit 6\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 6\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 6\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 6\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 6\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 6\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 6\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r3, Z+3            ; load stream 1 next G byte\n" \
+"    bst r16, 5             ; stream 0 B bit 5\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 5\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 5\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 5\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 5\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 5\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 5\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r4, Z+6            ; load stream 2 next G byte\n" \
+"    bst r16, 4             ; stream 0 B bit 4\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 4\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 4\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 4\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 4\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 4\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 4\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r5, Z+9            ; load stream 3 next G byte\n" \
+"    bst r16, 3             ; stream 0 B bit 3\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 3\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 3\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 3\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 3\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 3\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 3\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r6, Z+12           ; load stream 4 next G byte\n" \
+"    bst r16, 2             ; stream 0 B bit 2\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 2\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 2\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 2\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 2\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 2\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 2\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r7, Z+15           ; load stream 5 next G byte\n" \
+"    bst r16, 1             ; stream 0 B bit 1\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 1\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 1\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 1\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 1\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 1\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 1\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    ldd r8, Z+18           ; load stream 6 next G byte\n" \
+"    bst r16, 0             ; stream 0 B bit 0\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r17, 0\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r18, 0\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r19, 0\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r20, 0\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r21, 0\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r26       ; pins lo -> hi\n" \
+"    bld r23, %[pin5]\n" \
+"    bst r22, 0\n" \
+"    bld r23, %[pin6]\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pins hi -> colour output bits\n" \
+"    bst r2, 7              ; stream 0 G bit 7\n" \
+"    bld r23, %[pin0]\n" \
+"    bst r3, 7\n" \
+"    bld r23, %[pin1]\n" \
+"    bst r4, 7\n" \
+"    bld r23, %[pin2]\n" \
+"    bst r5, 7\n" \
+"    bld r23, %[pin3]\n" \
+"    bst r6, 7\n" \
+"    bld r23, %[pin4]\n" \
+"    bst r7, 7\n" \
+WS2811_PAD_LO \
+"    out %[port], r27       ; pins hi -> lo if not already low\n" \
+"    sbrs r25, 7            ; more rows left?\n" \
+"    rjmp 1b                ; (outer) loop if required\n" \
+"3:  out __SREG__, r0       ; reenable interrupts if required\n" \
+: \
+: [rgb] "z" (RGB), \
+  [len] "r" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin0] "I" (PIN0), \
+  [pin1] "I" (PIN1), \
+  [pin2] "I" (PIN2), \
+  [pin3] "I" (PIN3), \
+  [pin4] "I" (PIN4), \
+  [pin5] "I" (PIN5), \
+  [pin6] "I" (PIN6) \
+: "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11", "r12", \
+  "r13", "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r21", "r22", \
+  "r23", "r24", "r25", "r26", "r27", "cc", "memory" \
+)
+
+#if F_CPU == 20000000
+/*
+ * Inline asm macro to output eight streams of 24-bit GRB values in
+ * (G,R,B) order, MSBit first, only available at 20MHz.  The whole port is
+ * owned by the strips, pin n driving stream n, like with
+ * WS2811_OUT_8_PACKED.  The streams are read from a single array of rows
+ * of 8 RGB_t values, row i holding pixel i of the streams 0 to 7, i.e. the
+ * RGB_t [LEN][8] array WS2811_TRANSPOSE_8 takes, but no preprocessing
+ * is needed.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ *
+ * This works like WS2811_OUT_7_COMMON, the 5 more cycles per bit at 20MHz
+ * make room for the eighth bst/bld pair.  There aren't enough registers
+ * for a whole row, so only the colour being output is kept while the
+ * next one is loaded and moved in place with movw.  On the last row the
+ * row pointer isn't advanced, so the "next" G bytes loaded are the
+ * current row's ones and nothing past the end is read.
+ * r2 - r9 = stream 0 to 7 bytes of the colour being output
+ * r10 - r17 = stream 0 to 7 bytes of the next colour
+ * r18 = port value with the 8 pins set to their next output values
+ * r19 = all pins high
+ * r20 = temp value
+ * r24 = (+r25) outer loop counter
+ * r0 = saved SREG
+ *
+ * LEN can be at most 32767.
+ */
+#define WS2811_OUT_8_COMMON(PORT, RGB, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r24, %[len]\n" \
+"    ldi r19, 0xff\n" \
+"    in r0, __SREG__        ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 3f                ; nothing to output\n" \
+"2:  ld r2, Z               ; load stream 0 G byte\n" \
+"    ldd r3, Z+3            ; load stream 1 G byte\n" \
+"    ldd r4, Z+6            ; load stream 2 G byte\n" \
+"    ldd r5, Z+9            ; load stream 3 G byte\n" \
+"    ldd r6, Z+12           ; load stream 4 G byte\n" \
+"    ldd r7, Z+15           ; load stream 5 G byte\n" \
+"    ldd r8, Z+18           ; load stream 6 G byte\n" \
+"    ldd r9, Z+21           ; load stream 7 G byte\n" \
+"    bst r2, 7              ; stream 0 G bit 7\n" \
+"    bld r18, 0\n" \
+"    bst r3, 7\n" \
+"    bld r18, 1\n" \
+"    bst r4, 7\n" \
+"    bld r18, 2\n" \
+"    bst r5, 7\n" \
+"    bld r18, 3\n" \
+"    bst r6, 7\n" \
+"    bld r18, 4\n" \
+"    bst r7, 7\n" \
+"    bld r18, 5\n" \
+"    bst r8, 7\n" \
+"    bld r18, 6\n" \
+"    bst r9, 7\n" \
+/* G bits - load the R bytes */ \
+"1:  out %[port], r19       ; pins lo -> hi\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r10, Z+1           ; load stream 0 R byte\n" \
+"    ldd r11, Z+4           ; load stream 1 R byte\n" \
+"    bst r2, 6              ; stream 0 G bit 6\n" \
+"    bld r18, 0\n" \
+"    bst r3, 6\n" \
+"    bld r18, 1\n" \
+"    bst r4, 6\n" \
+"    bld r18, 2\n" \
+"    bst r5, 6\n" \
+"    bld r18, 3\n" \
+"    bst r6, 6\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 6\n" \
+"    bld r18, 5\n" \
+"    bst r8, 6\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 6\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r12, Z+7           ; load stream 2 R byte\n" \
+"    ldd r13, Z+10          ; load stream 3 R byte\n" \
+"    bst r2, 5              ; stream 0 G bit 5\n" \
+"    bld r18, 0\n" \
+"    bst r3, 5\n" \
+"    bld r18, 1\n" \
+"    bst r4, 5\n" \
+"    bld r18, 2\n" \
+"    bst r5, 5\n" \
+"    bld r18, 3\n" \
+"    bst r6, 5\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 5\n" \
+"    bld r18, 5\n" \
+"    bst r8, 5\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 5\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r14, Z+13          ; load stream 4 R byte\n" \
+"    ldd r15, Z+16          ; load stream 5 R byte\n" \
+"    bst r2, 4              ; stream 0 G bit 4\n" \
+"    bld r18, 0\n" \
+"    bst r3, 4\n" \
+"    bld r18, 1\n" \
+"    bst r4, 4\n" \
+"    bld r18, 2\n" \
+"    bst r5, 4\n" \
+"    bld r18, 3\n" \
+"    bst r6, 4\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 4\n" \
+"    bld r18, 5\n" \
+"    bst r8, 4\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 4\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r16, Z+19          ; load stream 6 R byte\n" \
+"    ldd r17, Z+22          ; load stream 7 R byte\n" \
+"    bst r2, 3              ; stream 0 G bit 3\n" \
+"    bld r18, 0\n" \
+"    bst r3, 3\n" \
+"    bld r18, 1\n" \
+"    bst r4, 3\n" \
+"    bld r18, 2\n" \
+"    bst r5, 3\n" \
+"    bld r18, 3\n" \
+"    bst r6, 3\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 3\n" \
+"    bld r18, 5\n" \
+"    bst r8, 3\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 3\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 2              ; stream 0 G bit 2\n" \
+"    bld r18, 0\n" \
+"    bst r3, 2\n" \
+"    bld r18, 1\n" \
+"    bst r4, 2\n" \
+"    bld r18, 2\n" \
+"    bst r5, 2\n" \
+"    bld r18, 3\n" \
+"    bst r6, 2\n" \
+"    bld r18, 4\n" \
+"    bst r7, 2\n" \
+"    bld r18, 5\n" \
+"    bst r8, 2\n" \
+"    bld r18, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r9, 2\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 1              ; stream 0 G bit 1\n" \
+"    bld r18, 0\n" \
+"    bst r3, 1\n" \
+"    bld r18, 1\n" \
+"    bst r4, 1\n" \
+"    bld r18, 2\n" \
+"    bst r5, 1\n" \
+"    bld r18, 3\n" \
+"    bst r6, 1\n" \
+"    bld r18, 4\n" \
+"    bst r7, 1\n" \
+"    bld r18, 5\n" \
+"    bst r8, 1\n" \
+"    bld r18, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r9, 1\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 0              ; stream 0 G bit 0\n" \
+"    bld r18, 0\n" \
+"    bst r3, 0\n" \
+"    bld r18, 1\n" \
+"    bst r4, 0\n" \
+"    bld r18, 2\n" \
+"    bst r5, 0\n" \
+"    bld r18, 3\n" \
+"    bst r6, 0\n" \
+"    bld r18, 4\n" \
+"    bst r7, 0\n" \
+"    bld r18, 5\n" \
+"    bst r8, 0\n" \
+"    bld r18, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r9, 0\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    movw r2, r10           ; move the R bytes in place\n" \
+"    movw r4, r12\n" \
+"    movw r6, r14\n" \
+"    movw r8, r16\n" \
+"    bst r2, 7              ; stream 0 R bit 7\n" \
+"    bld r18, 0\n" \
+"    bst r3, 7\n" \
+"    bld r18, 1\n" \
+"    bst r4, 7\n" \
+"    bld r18, 2\n" \
+"    bst r5, 7\n" \
+"    bld r18, 3\n" \
+"    bst r6, 7\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 7\n" \
+"    bld r18, 5\n" \
+"    bst r8, 7\n" \
+"    bld r18, 6\n" \
+/* R bits - load the B bytes */ \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 7\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r10, Z+2           ; load stream 0 B byte\n" \
+"    ldd r11, Z+5           ; load stream 1 B byte\n" \
+"    bst r2, 6              ; stream 0 R bit 6\n" \
+"    bld r18, 0\n" \
+"    bst r3, 6\n" \
+"    bld r18, 1\n" \
+"    bst r4, 6\n" \
+"    bld r18, 2\n" \
+"    bst r5, 6\n" \
+"    bld r18, 3\n" \
+"    bst r6, 6\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 6\n" \
+"    bld r18, 5\n" \
+"    bst r8, 6\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 6\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r12, Z+8           ; load stream 2 B byte\n" \
+"    ldd r13, Z+11          ; load stream 3 B byte\n" \
+"    bst r2, 5              ; stream 0 R bit 5\n" \
+"    bld r18, 0\n" \
+"    bst r3, 5\n" \
+"    bld r18, 1\n" \
+"    bst r4, 5\n" \
+"    bld r18, 2\n" \
+"    bst r5, 5\n" \
+"    bld r18, 3\n" \
+"    bst r6, 5\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 5\n" \
+"    bld r18, 5\n" \
+"    bst r8, 5\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 5\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r14, Z+14          ; load stream 4 B byte\n" \
+"    ldd r15, Z+17          ; load stream 5 B byte\n" \
+"    bst r2, 4              ; stream 0 R bit 4\n" \
+"    bld r18, 0\n" \
+"    bst r3, 4\n" \
+"    bld r18, 1\n" \
+"    bst r4, 4\n" \
+"    bld r18, 2\n" \
+"    bst r5, 4\n" \
+"    bld r18, 3\n" \
+"    bst r6, 4\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 4\n" \
+"    bld r18, 5\n" \
+"    bst r8, 4\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 4\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r16, Z+20          ; load stream 6 B byte\n" \
+"    ldd r17, Z+23          ; load stream 7 B byte\n" \
+"    bst r2, 3              ; stream 0 R bit 3\n" \
+"    bld r18, 0\n" \
+"    bst r3, 3\n" \
+"    bld r18, 1\n" \
+"    bst r4, 3\n" \
+"    bld r18, 2\n" \
+"    bst r5, 3\n" \
+"    bld r18, 3\n" \
+"    bst r6, 3\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 3\n" \
+"    bld r18, 5\n" \
+"    bst r8, 3\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 3\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 2              ; stream 0 R bit 2\n" \
+"    bld r18, 0\n" \
+"    bst r3, 2\n" \
+"    bld r18, 1\n" \
+"    bst r4, 2\n" \
+"    bld r18, 2\n" \
+"    bst r5, 2\n" \
+"    bld r18, 3\n" \
+"    bst r6, 2\n" \
+"    bld r18, 4\n" \
+"    bst r7, 2\n" \
+"    bld r18, 5\n" \
+"    bst r8, 2\n" \
+"    bld r18, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r9, 2\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 1              ; stream 0 R bit 1\n" \
+"    bld r18, 0\n" \
+"    bst r3, 1\n" \
+"    bld r18, 1\n" \
+"    bst r4, 1\n" \
+"    bld r18, 2\n" \
+"    bst r5, 1\n" \
+"    bld r18, 3\n" \
+"    bst r6, 1\n" \
+"    bld r18, 4\n" \
+"    bst r7, 1\n" \
+"    bld r18, 5\n" \
+"    bst r8, 1\n" \
+"    bld r18, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r9, 1\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 0              ; stream 0 R bit 0\n" \
+"    bld r18, 0\n" \
+"    bst r3, 0\n" \
+"    bld r18, 1\n" \
+"    bst r4, 0\n" \
+"    bld r18, 2\n" \
+"    bst r5, 0\n" \
+"    bld r18, 3\n" \
+"    bst r6, 0\n" \
+"    bld r18, 4\n" \
+"    bst r7, 0\n" \
+"    bld r18, 5\n" \
+"    bst r8, 0\n" \
+"    bld r18, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r9, 0\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    movw r2, r10           ; move the B bytes in place\n" \
+"    movw r4, r12\n" \
+"    movw r6, r14\n" \
+"    movw r8, r16\n" \
+"    bst r2, 7              ; stream 0 B bit 7\n" \
+"    bld r18, 0\n" \
+"    bst r3, 7\n" \
+"    bld r18, 1\n" \
+"    bst r4, 7\n" \
+"    bld r18, 2\n" \
+"    bst r5, 7\n" \
+"    bld r18, 3\n" \
+"    bst r6, 7\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 7\n" \
+"    bld r18, 5\n" \
+"    bst r8, 7\n" \
+"    bld r18, 6\n" \
+/* B bits - move to the next row, load its G bytes */ \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 7\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    sbiw r24, 1            ; decrement outer loop counter, set flags\n" \
+"    sbc r20, r20           ; no next row: 0xff\n" \
+"    com r20\n" \
+"    andi r20, 24           ; row size or 0 on the last row\n" \
+"    bst r2, 6              ; stream 0 B bit 6\n" \
+"    bld r18, 0\n" \
+"    bst r3, 6\n" \
+"    bld r18, 1\n" \
+"    bst r4, 6\n" \
+"    bld r18, 2\n" \
+"    bst r5, 6\n" \
+"    bld r18, 3\n" \
+"    bst r6, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bld r18, 4\n" \
+"    bst r7, 6\n" \
+"    bld r18, 5\n" \
+"    bst r8, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bld r18, 6\n" \
+"    bst r9, 6\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    add r30, r20           ; move to the next row\n" \
+"    adc r31, __zero_reg__\n" \
+"    ldd r10, Z+0           ; load stream 0 G byte\n" \
+"    bst r2, 5              ; stream 0 B bit 5\n" \
+"    bld r18, 0\n" \
+"    bst r3, 5\n" \
+"    bld r18, 1\n" \
+"    bst r4, 5\n" \
+"    bld r18, 2\n" \
+"    bst r5, 5\n" \
+"    bld r18, 3\n" \
+"    bst r6, 5\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 5\n" \
+"    bld r18, 5\n" \
+"    bst r8, 5\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 5\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r11, Z+3           ; load stream 1 G byte\n" \
+"    ldd r12, Z+6           ; load stream 2 G byte\n" \
+"    bst r2, 4              ; stream 0 B bit 4\n" \
+"    bld r18, 0\n" \
+"    bst r3, 4\n" \
+"    bld r18, 1\n" \
+"    bst r4, 4\n" \
+"    bld r18, 2\n" \
+"    bst r5, 4\n" \
+"    bld r18, 3\n" \
+"    bst r6, 4\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 4\n" \
+"    bld r18, 5\n" \
+"    bst r8, 4\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 4\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r13, Z+9           ; load stream 3 G byte\n" \
+"    ldd r14, Z+12          ; load stream 4 G byte\n" \
+"    bst r2, 3              ; stream 0 B bit 3\n" \
+"    bld r18, 0\n" \
+"    bst r3, 3\n" \
+"    bld r18, 1\n" \
+"    bst r4, 3\n" \
+"    bld r18, 2\n" \
+"    bst r5, 3\n" \
+"    bld r18, 3\n" \
+"    bst r6, 3\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 3\n" \
+"    bld r18, 5\n" \
+"    bst r8, 3\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 3\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r15, Z+15          ; load stream 5 G byte\n" \
+"    ldd r16, Z+18          ; load stream 6 G byte\n" \
+"    bst r2, 2              ; stream 0 B bit 2\n" \
+"    bld r18, 0\n" \
+"    bst r3, 2\n" \
+"    bld r18, 1\n" \
+"    bst r4, 2\n" \
+"    bld r18, 2\n" \
+"    bst r5, 2\n" \
+"    bld r18, 3\n" \
+"    bst r6, 2\n" \
+"    bld r18, 4\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r7, 2\n" \
+"    bld r18, 5\n" \
+"    bst r8, 2\n" \
+"    bld r18, 6\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bst r9, 2\n" \
+"    bld r18, 7\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ldd r17, Z+21          ; load stream 7 G byte\n" \
+"    bst r2, 1              ; stream 0 B bit 1\n" \
+"    bld r18, 0\n" \
+"    bst r3, 1\n" \
+"    bld r18, 1\n" \
+"    bst r4, 1\n" \
+"    bld r18, 2\n" \
+"    bst r5, 1\n" \
+"    bld r18, 3\n" \
+"    bst r6, 1\n" \
+"    bld r18, 4\n" \
+"    bst r7, 1\n" \
+"    bld r18, 5\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r8, 1\n" \
+"    bld r18, 6\n" \
+"    bst r9, 1\n" \
+"    bld r18, 7\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 0              ; stream 0 B bit 0\n" \
+"    bld r18, 0\n" \
+"    bst r3, 0\n" \
+"    bld r18, 1\n" \
+"    movw r2, r10           ; move the next G bytes in place\n" \
+"    bst r4, 0\n" \
+"    bld r18, 2\n" \
+"    bst r5, 0\n" \
+"    bld r18, 3\n" \
+"    movw r4, r12\n" \
+"    bst r6, 0\n" \
+"    bld r18, 4\n" \
+"    bst r7, 0\n" \
+"    bld r18, 5\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    movw r6, r14\n" \
+"    bst r8, 0\n" \
+"    bld r18, 6\n" \
+"    bst r9, 0\n" \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    bld r18, 7\n" \
+"    movw r8, r16\n" \
+"    nop\n" \
+"    nop\n" \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    bst r2, 7              ; stream 0 G bit 7\n" \
+"    bld r18, 0\n" \
+"    bst r3, 7\n" \
+"    bld r18, 1\n" \
+"    bst r4, 7\n" \
+"    bld r18, 2\n" \
+"    bst r5, 7\n" \
+"    bld r18, 3\n" \
+"    bst r6, 7\n" \
+"    bld r18, 4\n" \
+"    bst r7, 7\n" \
+"    bld r18, 5\n" \
+"    bst r8, 7\n" \
+"    bld r18, 6\n" \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    bst r9, 7\n" \
+"    sbrs r25, 7            ; more rows left?\n" \
+"    rjmp 1b                ; (outer) loop if required\n" \
+"3:  out __SREG__, r0       ; reenable interrupts if required\n" \
+: \
+: [rgb] "z" (RGB), \
+  [len] "r" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)) \
+: "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11", "r12", \
+  "r13", "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r24", "r25", \
+  "cc", "memory" \
+)
+#endif
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+/*
+ * Inline asm macro to output up to eight streams of 24-bit GRB values
+ * from data pre-grouped into port values ("bit slices"), MSBit first.  The
+ * whole port is owned by the strips: each of its eight pins drives one
+ * strip and its other uses are overwritten while the macro runs.
+ * Each byte of DATA is output to the port in one 1.25us bit slot, so for
+ * LEN pixels there have to be LEN * 24 bytes of data, bit n of each byte
+ * being the next bit for the strip on pin n.  Pixel i of every strip
+ * is thus described by DATA[i * 24] to DATA[i * 24 + 23], in (G,R,B) order,
+ * MSBit first.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ * r18 = port value (slice) to be output
+ * r19 = all pins high
+ * r18:r19 = temp value
+ * r16 = saved SREG
+ *
+ * LEN can be at most 1365 because the slot counter is signed 16-bit.
+ */
+#define WS2811_OUT_8_PACKED(PORT, DATA, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by 8 times the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    ldi r19, 0xff\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    rjmp 2f                ; start with the end-of-loop check\n" \
+/* last bit - finish it without loading */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    rjmp 4f\n" \
+/* loop over all the bits, one port value per bit */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"2:  sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    brlt 3b                ; no more slices, don't load beyond the end\n" \
+"    ld r18, %a[data]+      ; load next slice\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    brge 1b                ; loop if required\n" \
+"    out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [data] "e" (DATA), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)) \
+: "r16", "r18", "r19", "cc", "memory" \
+)
+
+/*
+ * Same as WS2811_OUT_8_PACKED but reading the slices from flash with lpm,
+ * so that precomputed animations can be played without copying them to
+ * RAM.  Flash data has to be in the first 64KB.
+ */
+#define WS2811_OUT_8_PACKED_P(PORT, DATA, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by 8 times the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    ldi r19, 0xff\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    rjmp 2f                ; start with the end-of-loop check\n" \
+/* last bit - finish it without loading */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    rjmp 4f\n" \
+/* loop over all the bits, one port value per bit */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"2:  sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    brlt 3b                ; no more slices, don't load beyond the end\n" \
+"    lpm r18, Z+            ; load next slice\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+"    brge 1b                ; loop if required\n" \
+"    out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [data] "z" (DATA), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)) \
+: "r16", "r18", "r19", "cc", "memory" \
+)
+
+/*
+ * Inline asm macro to output up to sixteen streams of 24-bit GRB values
+ * from two streams of bit slices, one for each of two ports, in the same
+ * way as WS2811_OUT_8_PACKED.  Like in WS2811_OUT_2 the two ports are
+ * written with back-to-back "out" instructions so port 1 lags port 0 by
+ * one cycle (62.5ns) but the pulse widths are identical.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ * r18 = port 0 value (slice) to be output
+ * r20 = port 1 value (slice) to be output
+ * r19 = all pins high
+ * r18:r19 = temp value
+ * r16 = saved SREG
+ *
+ * LEN can be at most 1365 because the slot counter is signed 16-bit.
  */
-#define WS2811_OUT_4_COMMON(PORT, PIN0, RGB0, PIN1, RGB1, PIN2, RGB2, PIN3, RGB3, LEN) \
+#define WS2811_OUT_16_PACKED(PORT0, DATA0, PORT1, DATA1, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by 8 times the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    ldi r19, 0xff\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    rjmp 2f                ; start with the end-of-loop check\n" \
+/* last bit - finish it without loading */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    rjmp 4f\n" \
+/* loop over all the bits, one value per port per bit */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port0], r19      ; port 0 pins lo -> hi\n" \
+"    out %[port1], r19      ; port 1 pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; port 0 pins hi -> colour output bits\n" \
+"    out %[port1], r20      ; port 1 pins hi -> colour output bits\n" \
+"2:  sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    brlt 3b                ; no more slices, don't load beyond the end\n" \
+"    ld r18, %a[data0]+     ; load next port 0 slice\n" \
+"    ld r20, %a[data1]+     ; load next port 1 slice\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    out %[port0], __zero_reg__ ; port 0 pins hi -> lo if not already low\n" \
+"    out %[port1], __zero_reg__ ; port 1 pins hi -> lo if not already low\n" \
+"    brge 1b                ; loop if required\n" \
+"    out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [data0] "e" (DATA0), \
+  [data1] "e" (DATA1), \
+  [len] "w" (LEN), \
+  [port0] "I" (_SFR_IO_ADDR(PORT0)), \
+  [port1] "I" (_SFR_IO_ADDR(PORT1)) \
+: "r16", "r18", "r19", "r20", "cc", "memory" \
+)
+
+/*
+ * Same as WS2811_OUT_16_PACKED but reading the slices from flash with lpm.
+ * Only Z can be used with lpm so the two ports' slices come interleaved
+ * from a single array: port 0's first slice, port 1's first slice, etc.,
+ * 48 bytes per pixel.  Flash data has to be in the first 64KB.
+ */
+#define WS2811_OUT_16_PACKED_P(PORT0, PORT1, DATA, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by 8 times the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    lsl %A[len]\n" \
+"    rol %B[len]\n" \
+"    ldi r19, 0xff\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    rjmp 2f                ; start with the end-of-loop check\n" \
+/* last bit - finish it without loading */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+"    rjmp 4f\n" \
+/* loop over all the bits, one value per port per bit */ \
+"1:\n" \
+WS2811_PAD_HI \
+"    out %[port0], r19      ; port 0 pins lo -> hi\n" \
+"    out %[port1], r19      ; port 1 pins lo -> hi\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port0], r18      ; port 0 pins hi -> colour output bits\n" \
+"    out %[port1], r20      ; port 1 pins hi -> colour output bits\n" \
+"2:  sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    brlt 3b                ; no more slices, don't load beyond the end\n" \
+"    lpm r18, Z+            ; load next port 0 slice\n" \
+"    lpm r20, Z+            ; load next port 1 slice\n" \
+"    nop\n" \
+"4:\n" \
+WS2811_PAD_LO \
+"    out %[port0], __zero_reg__ ; port 0 pins hi -> lo if not already low\n" \
+"    out %[port1], __zero_reg__ ; port 1 pins hi -> lo if not already low\n" \
+"    brge 1b                ; loop if required\n" \
+"    out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [data] "z" (DATA), \
+  [len] "w" (LEN), \
+  [port0] "I" (_SFR_IO_ADDR(PORT0)), \
+  [port1] "I" (_SFR_IO_ADDR(PORT1)) \
+: "r16", "r18", "r19", "r20", "cc", "memory" \
+)
+
+#else /* F_CPU < 16000000 */
+
+/*
+ * 8MHz (and 12MHz) versions of WS2811_OUT_1 and WS2811_OUT_8_PACKED.
+ * A bit is 10 cycles here: 2 cycles hi, 6 cycles hi or lo depending on the
+ * bit value, 2 cycles lo, and 3 of them are taken by the "out"
+ * instructions, so the loop is unrolled over the 8 bits of a byte (8
+ * slices) and the loads, the loop counter and the jump back are spread
+ * over the gaps.  The loop starts in the middle of the 1st bit as there's
+ * no room for the jump at the end of the 8th bit.  There's no time for
+ * more than one stream with its own buffer, more strips need to be
+ * driven from bit slices.
+ * 0 bits are 250ns hi, 1000ns lo, 1 bits are 1000ns hi, 250ns lo.
+ * r18 = byte to be output
+ * r18:r19 = temp value
+ * r21 = port original value with the pin low
+ * r22 = port original value with the pin high
+ * r23 = port original value with the pin set to the next output bit
+ * r16 = saved SREG
+ */
+#define WS2811_OUT_1(PORT, PIN, RGB, LEN) \
 asm volatile( \
 /* initialise */ \
-"    movw r24, %[len]      ; multiply len by 3\n" \
-"    add r24, %A[len]\n" \
-"    adc r25, %B[len]\n" \
-"    add r24, %A[len]\n" \
-"    adc r25, %B[len]\n" \
+"    movw r18, %A[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
 "    in r21, %[port]\n" \
+"    cbr r21, 1 << %[pin]\n" \
 "    mov r22, r21\n" \
-"    sbr r22, (1 << %[pin0]) | (1 << %[pin1]) | (1 << %[pin2]) | (1 << %[pin3])\n" \
+"    sbr r22, 1 << %[pin]\n" \
 "    mov r23, r21\n" \
-"    movw r26, %[rgb0]\n" \
-"    ld r17, X+             ; load next stream 0 byte\n" \
-"    movw %[rgb0], r26\n" \
-"    movw r26, %[rgb1]\n" \
-"    ld r18, X+             ; load next stream 1 byte\n" \
-"    movw %[rgb1], r26\n" \
-"    ld r19, %a[rgb2]+      ; load next stream 2 byte\n" \
-"    ld r20, %a[rgb3]+      ; load next stream 3 byte\n" \
-"    ldi r16, 6             ; load inner loop counter\n" \
-"    in r15, __SREG__       ; timing-critical, so no interrupts\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
 "    cli\n" \
-"    rjmp 2f                ; start with the end-of-loop check\n" \
-/* loop over the first 6 bits */ \
-"1:  out %[port], r22       ; pins lo -> hi\n" \
+"    sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"2:  ld r18, %a[rgb]+       ; load first byte\n" \
+"    bst r18, 7\n" \
+"    bld r23, %[pin]\n" \
+/* 1st bit, the loop jumps back in after the colour output */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
 "    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
 "    nop\n" \
-"    lsl r17                ; shift stream 0 byte to next bit, set Carry\n" \
-"    out %[port], r23       ; pins hi -> colour output bit\n" \
-"    bst r17, 7\n" \
-"    bld r23, %[pin0]       ; load r17 bit 7 into pin0\n" \
-"    lsl r18                ; shift stream 1 byte to next bit, set Carry\n" \
-"    bst r18, 7\n" \
-"    bld r23, %[pin1]       ; load r18 bit 7 into pin1\n" \
-"    lsl r19                ; shift stream 2 byte to next bit, set Carry\n" \
-"    bst r19, 7\n" \
-"    bld r23, %[pin2]       ; load r19 bit 7 into pin2\n" \
-"    lsl r20                ; shift stream 3 byte to next bit, set Carry\n" \
-"    bst r20, 7\n" \
-"    bld r23, %[pin3]       ; load r20 bit 7 into pin3\n" \
-"    out %[port], r21       ; pins hi -> lo if not already low\n" \
-"    dec r16                ; decrement loop counter, set flags\n" \
-"    brne 1b                ; (inner) loop if required\n" \
-"    ldi r16, 6             ; reload inner loop counter\n" \
-/* 7th bit - output & fetch next values */ \
-"    out %[port], r22       ; pins lo -> hi\n" \
 "    nop\n" \
+"1:  bst r18, 6             ; load bit 6 into the pin\n" \
+"    bld r23, %[pin]\n" \
 "    nop\n" \
-"    bst r17, 6\n" \
-"    out %[port], r23       ; pins hi -> colour output bit\n" \
-"    bld r23, %[pin0]       ; load r17 bit 6 into pin0\n" \
-"    bst r18, 6\n" \
-"    bld r23, %[pin1]       ; load r18 bit 6 into pin1\n" \
-"    bst r19, 6\n" \
-"    bld r23, %[pin2]       ; load r19 bit 6 into pin2\n" \
-"    bst r20, 6\n" \
-"    bld r23, %[pin3]       ; load r20 bit 6 into pin3\n" \
-"    movw r26, %[rgb0]\n" \
-"    ld r17, X+             ; load next stream 0 byte\n" \
-"    movw %[rgb0], r26\n" \
-"    out %[port], r21       ; pins hi -> lo if not already low\n" \
-"    movw r26, %[rgb1]\n" \
-"    ld r18, X+             ; load next stream 1 byte\n" \
-/* 8th bit - output & fetch next values */ \
-"    out %[port], r22       ; pins lo -> hi\n" \
-"    movw %[rgb1], r26\n" \
-"    ld r19, %a[rgb2]+      ; load next stream 2 byte\n" \
-"    out %[port], r23       ; pins hi -> colour output bit\n" \
-"    ld r20, %a[rgb3]+      ; load next stream 3 byte\n" \
-"2:  bst r17, 7\n" \
-"    bld r23, %[pin0]       ; load r17 bit 7 into pin0\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+/* 2nd to 7th bits */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    bst r18, 5\n" \
+"    bld r23, %[pin]\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    bst r18, 4\n" \
+"    bld r23, %[pin]\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    bst r18, 3\n" \
+"    bld r23, %[pin]\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    bst r18, 2\n" \
+"    bld r23, %[pin]\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    bst r18, 1\n" \
+"    bld r23, %[pin]\n" \
+"    sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    bst r18, 0\n" \
+"    bld r23, %[pin]\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+/* 8th bit - fetch the next byte if any */ \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    brlt 3f                ; no more bytes, don't load beyond the end\n" \
+"    ld r18, %a[rgb]+       ; load next byte\n" \
 "    bst r18, 7\n" \
-"    bld r23, %[pin1]       ; load r18 bit 7 into pin1\n" \
-"    bst r19, 7\n" \
-"    bld r23, %[pin2]       ; load r19 bit 7 into pin2\n" \
-"    bst r20, 7\n" \
-"    sbiw r24, 1            ; decrement outer loop counter\n" \
-"    out %[port], r21       ; pins hi -> lo if not already low\n" \
-"    bld r23, %[pin3]       ; load r20 bit 7 into pin3\n" \
-"    brge 1b                ; (outer) loop if required\n" \
-"    out __SREG__, r15      ; reenable interrupts if required\n" \
+"    bld r23, %[pin]\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r22       ; pin lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r23       ; pin hi -> colour output bit\n" \
+"    rjmp 1b                ; loop\n" \
+/* last byte - finish the 8th bit */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], r21       ; pin hi -> lo if not already low\n" \
+"4:  out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [rgb] "e" (RGB), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)), \
+  [pin] "I" (PIN) \
+: "r16", "r18", "r19", "r21", "r22", "r23", "cc", "memory" \
+)
+
+/*
+ * r18 = port value (slice) to be output
+ * r19 = all pins high
+ * r18:r19 = temp value
+ * r16 = saved SREG
+ *
+ * LEN can be at most 10922 because the byte counter is signed 16-bit.
+ */
+#define WS2811_OUT_8_PACKED(PORT, DATA, LEN) \
+asm volatile( \
+/* initialise */ \
+"    movw r18, %A[len]      ; multiply len by the pixel size\n" \
+WS2811_MUL_LEN("%A[len]", "%B[len]", "r18", "r19") \
+"    ldi r19, 0xff\n" \
+"    in r16, __SREG__       ; timing-critical, so no interrupts\n" \
+"    cli\n" \
+"    sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    brge 2f\n" \
+"    rjmp 4f                ; nothing to output\n" \
+"2:  ld r18, %a[data]+      ; load first slice\n" \
+/* 1st slice, the loop jumps back in after the colour output */ \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    nop\n" \
+"    nop\n" \
+"1:  ld r18, %a[data]+      ; load next slice\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+/* 2nd to 7th slices */ \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ld r18, %a[data]+\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ld r18, %a[data]+\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ld r18, %a[data]+\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ld r18, %a[data]+\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ld r18, %a[data]+\n" \
+"    sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    ld r18, %a[data]+\n" \
+"    nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+/* 8th slice - fetch the next one if any */ \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    brlt 3f                ; no more slices, don't load beyond the end\n" \
+"    ld r18, %a[data]+\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"    nop\n" \
+WS2811_PAD_HI \
+"    out %[port], r19       ; pins lo -> hi\n" \
+"    nop\n" \
+WS2811_PAD_DATA \
+"    out %[port], r18       ; pins hi -> colour output bits\n" \
+"    rjmp 1b                ; loop\n" \
+/* last slice - finish it */ \
+"3:  nop\n" \
+"    nop\n" \
+"    nop\n" \
+WS2811_PAD_LO \
+"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
+"4:  out __SREG__, r16      ; reenable interrupts if required\n" \
+: \
+: [data] "e" (DATA), \
+  [len] "w" (LEN), \
+  [port] "I" (_SFR_IO_ADDR(PORT)) \
+: "r16", "r18", "r19", "cc", "memory" \
+)
+#endif
+
+#if WS2811_PIXEL_BYTES == 3
+/* Same as WS2811_OUT_1_RAMP going from FROM to TO in LEN pixels. */
+#define WS2811_OUT_1_GRADIENT(PORT, PIN, FROM, TO, LEN) \
+    WS2811_OUT_1_RAMP(PORT, PIN, FROM, \
+            WS2811_gradient_step((FROM).g, (TO).g, LEN), \
+            WS2811_gradient_step((FROM).r, (TO).r, LEN), \
+            WS2811_gradient_step((FROM).b, (TO).b, LEN), LEN)
+
+/* Output LEN pixels of the colour RGB. */
+#define WS2811_OUT_1_FILL(PORT, PIN, RGB, LEN) \
+    WS2811_OUT_1_RAMP(PORT, PIN, RGB, 0, 0, 0, LEN)
+
+/*
+ * Convert pixel rows of eight strips into the bit slices expected by
+ * WS2811_OUT_8_PACKED, in place.  RGB points to LEN rows of 8 RGB_t
+ * values, row i holding pixel i of the strips on pins 0 to 7 (in that
+ * order), i.e. a RGB_t [LEN][8] array.  After the conversion the same
+ * memory contains the LEN * 24 slices and can be passed directly to
+ * WS2811_OUT_8_PACKED.  Unused strips just need zeroed columns.  For
+ * strips kept in separate buffers see WS2811_transpose_8_strips() below.
+ *
+ * Each group of 8 bytes is transposed as an 8x8 bit matrix with three
+ * rounds of masked swaps (1-bit, 2-bit and 4-bit blocks) instead of
+ * shifting the 64 bits one by one, which takes 92 instead of 128 cycles.
+ * One row takes 377 cycles including the loads and stores, or 47 cycles
+ * per strip pixel (23.5us per row at 16MHz, less than the 30us needed to
+ * output it).
+ * r0, r2 - r8 = G bytes of strips 7 to 0, then G slices 0 to 7
+ * r9 - r16 = R bytes of strips 7 to 0, then R slices 0 to 7
+ * r17 - r24 = B bytes of strips 7 to 0, then B slices 0 to 7
+ * r25 = temp value
+ */
+#ifdef __AVR__
+#define WS2811_TRANSPOSE_8(RGB, LEN) \
+asm volatile( \
+"    rjmp 2f                ; start with the end-of-loop check\n" \
+/* load a whole row first as the slices overwrite it */ \
+"1:  ldd r0, Z+21           ; load strip 7 G\n" \
+"    ldd r2, Z+18               ; load strip 6 G\n" \
+"    ldd r3, Z+15               ; load strip 5 G\n" \
+"    ldd r4, Z+12               ; load strip 4 G\n" \
+"    ldd r5, Z+9                ; load strip 3 G\n" \
+"    ldd r6, Z+6                ; load strip 2 G\n" \
+"    ldd r7, Z+3                ; load strip 1 G\n" \
+"    ld r8, Z                   ; load strip 0 G\n" \
+"    ldd r9, Z+22               ; load strip 7 R\n" \
+"    ldd r10, Z+19              ; load strip 6 R\n" \
+"    ldd r11, Z+16              ; load strip 5 R\n" \
+"    ldd r12, Z+13              ; load strip 4 R\n" \
+"    ldd r13, Z+10              ; load strip 3 R\n" \
+"    ldd r14, Z+7               ; load strip 2 R\n" \
+"    ldd r15, Z+4               ; load strip 1 R\n" \
+"    ldd r16, Z+1               ; load strip 0 R\n" \
+"    ldd r17, Z+23              ; load strip 7 B\n" \
+"    ldd r18, Z+20              ; load strip 6 B\n" \
+"    ldd r19, Z+17              ; load strip 5 B\n" \
+"    ldd r20, Z+14              ; load strip 4 B\n" \
+"    ldd r21, Z+11              ; load strip 3 B\n" \
+"    ldd r22, Z+8               ; load strip 2 B\n" \
+"    ldd r23, Z+5               ; load strip 1 B\n" \
+"    ldd r24, Z+2               ; load strip 0 B\n" \
+/* transpose the G bytes */ \
+"    mov r25, r2                ; swap single bits of rows 0 and 1\n" \
+"    lsr r25\n" \
+"    eor r25, r0\n" \
+"    andi r25, 0x55\n" \
+"    eor r0, r25\n" \
+"    lsl r25\n" \
+"    eor r2, r25\n" \
+"    mov r25, r4\n" \
+"    lsr r25\n" \
+"    eor r25, r3\n" \
+"    andi r25, 0x55\n" \
+"    eor r3, r25\n" \
+"    lsl r25\n" \
+"    eor r4, r25\n" \
+"    mov r25, r6\n" \
+"    lsr r25\n" \
+"    eor r25, r5\n" \
+"    andi r25, 0x55\n" \
+"    eor r5, r25\n" \
+"    lsl r25\n" \
+"    eor r6, r25\n" \
+"    mov r25, r8\n" \
+"    lsr r25\n" \
+"    eor r25, r7\n" \
+"    andi r25, 0x55\n" \
+"    eor r7, r25\n" \
+"    lsl r25\n" \
+"    eor r8, r25\n" \
+"    mov r25, r3                ; swap bit pairs of rows 0 and 2\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r0\n" \
+"    andi r25, 0x33\n" \
+"    eor r0, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r3, r25\n" \
+"    mov r25, r4\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r2\n" \
+"    andi r25, 0x33\n" \
+"    eor r2, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r4, r25\n" \
+"    mov r25, r7\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r5\n" \
+"    andi r25, 0x33\n" \
+"    eor r5, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r7, r25\n" \
+"    mov r25, r8\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r6\n" \
+"    andi r25, 0x33\n" \
+"    eor r6, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r8, r25\n" \
+"    mov r25, r5                ; swap nibbles of rows 0 and 4\n" \
+"    swap r25\n" \
+"    eor r25, r0\n" \
+"    andi r25, 0x0f\n" \
+"    eor r0, r25\n" \
+"    swap r25\n" \
+"    eor r5, r25\n" \
+"    mov r25, r6\n" \
+"    swap r25\n" \
+"    eor r25, r2\n" \
+"    andi r25, 0x0f\n" \
+"    eor r2, r25\n" \
+"    swap r25\n" \
+"    eor r6, r25\n" \
+"    mov r25, r7\n" \
+"    swap r25\n" \
+"    eor r25, r3\n" \
+"    andi r25, 0x0f\n" \
+"    eor r3, r25\n" \
+"    swap r25\n" \
+"    eor r7, r25\n" \
+"    mov r25, r8\n" \
+"    swap r25\n" \
+"    eor r25, r4\n" \
+"    andi r25, 0x0f\n" \
+"    eor r4, r25\n" \
+"    swap r25\n" \
+"    eor r8, r25\n" \
+/* transpose the R bytes */ \
+"    mov r25, r10               ; swap single bits of rows 0 and 1\n" \
+"    lsr r25\n" \
+"    eor r25, r9\n" \
+"    andi r25, 0x55\n" \
+"    eor r9, r25\n" \
+"    lsl r25\n" \
+"    eor r10, r25\n" \
+"    mov r25, r12\n" \
+"    lsr r25\n" \
+"    eor r25, r11\n" \
+"    andi r25, 0x55\n" \
+"    eor r11, r25\n" \
+"    lsl r25\n" \
+"    eor r12, r25\n" \
+"    mov r25, r14\n" \
+"    lsr r25\n" \
+"    eor r25, r13\n" \
+"    andi r25, 0x55\n" \
+"    eor r13, r25\n" \
+"    lsl r25\n" \
+"    eor r14, r25\n" \
+"    mov r25, r16\n" \
+"    lsr r25\n" \
+"    eor r25, r15\n" \
+"    andi r25, 0x55\n" \
+"    eor r15, r25\n" \
+"    lsl r25\n" \
+"    eor r16, r25\n" \
+"    mov r25, r11               ; swap bit pairs of rows 0 and 2\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r9\n" \
+"    andi r25, 0x33\n" \
+"    eor r9, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r11, r25\n" \
+"    mov r25, r12\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r10\n" \
+"    andi r25, 0x33\n" \
+"    eor r10, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r12, r25\n" \
+"    mov r25, r15\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r13\n" \
+"    andi r25, 0x33\n" \
+"    eor r13, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r15, r25\n" \
+"    mov r25, r16\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r14\n" \
+"    andi r25, 0x33\n" \
+"    eor r14, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r16, r25\n" \
+"    mov r25, r13               ; swap nibbles of rows 0 and 4\n" \
+"    swap r25\n" \
+"    eor r25, r9\n" \
+"    andi r25, 0x0f\n" \
+"    eor r9, r25\n" \
+"    swap r25\n" \
+"    eor r13, r25\n" \
+"    mov r25, r14\n" \
+"    swap r25\n" \
+"    eor r25, r10\n" \
+"    andi r25, 0x0f\n" \
+"    eor r10, r25\n" \
+"    swap r25\n" \
+"    eor r14, r25\n" \
+"    mov r25, r15\n" \
+"    swap r25\n" \
+"    eor r25, r11\n" \
+"    andi r25, 0x0f\n" \
+"    eor r11, r25\n" \
+"    swap r25\n" \
+"    eor r15, r25\n" \
+"    mov r25, r16\n" \
+"    swap r25\n" \
+"    eor r25, r12\n" \
+"    andi r25, 0x0f\n" \
+"    eor r12, r25\n" \
+"    swap r25\n" \
+"    eor r16, r25\n" \
+/* transpose the B bytes */ \
+"    mov r25, r18               ; swap single bits of rows 0 and 1\n" \
+"    lsr r25\n" \
+"    eor r25, r17\n" \
+"    andi r25, 0x55\n" \
+"    eor r17, r25\n" \
+"    lsl r25\n" \
+"    eor r18, r25\n" \
+"    mov r25, r20\n" \
+"    lsr r25\n" \
+"    eor r25, r19\n" \
+"    andi r25, 0x55\n" \
+"    eor r19, r25\n" \
+"    lsl r25\n" \
+"    eor r20, r25\n" \
+"    mov r25, r22\n" \
+"    lsr r25\n" \
+"    eor r25, r21\n" \
+"    andi r25, 0x55\n" \
+"    eor r21, r25\n" \
+"    lsl r25\n" \
+"    eor r22, r25\n" \
+"    mov r25, r24\n" \
+"    lsr r25\n" \
+"    eor r25, r23\n" \
+"    andi r25, 0x55\n" \
+"    eor r23, r25\n" \
+"    lsl r25\n" \
+"    eor r24, r25\n" \
+"    mov r25, r19               ; swap bit pairs of rows 0 and 2\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r17\n" \
+"    andi r25, 0x33\n" \
+"    eor r17, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r19, r25\n" \
+"    mov r25, r20\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r18\n" \
+"    andi r25, 0x33\n" \
+"    eor r18, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r20, r25\n" \
+"    mov r25, r23\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r21\n" \
+"    andi r25, 0x33\n" \
+"    eor r21, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r23, r25\n" \
+"    mov r25, r24\n" \
+"    lsr r25\n" \
+"    lsr r25\n" \
+"    eor r25, r22\n" \
+"    andi r25, 0x33\n" \
+"    eor r22, r25\n" \
+"    lsl r25\n" \
+"    lsl r25\n" \
+"    eor r24, r25\n" \
+"    mov r25, r21               ; swap nibbles of rows 0 and 4\n" \
+"    swap r25\n" \
+"    eor r25, r17\n" \
+"    andi r25, 0x0f\n" \
+"    eor r17, r25\n" \
+"    swap r25\n" \
+"    eor r21, r25\n" \
+"    mov r25, r22\n" \
+"    swap r25\n" \
+"    eor r25, r18\n" \
+"    andi r25, 0x0f\n" \
+"    eor r18, r25\n" \
+"    swap r25\n" \
+"    eor r22, r25\n" \
+"    mov r25, r23\n" \
+"    swap r25\n" \
+"    eor r25, r19\n" \
+"    andi r25, 0x0f\n" \
+"    eor r19, r25\n" \
+"    swap r25\n" \
+"    eor r23, r25\n" \
+"    mov r25, r24\n" \
+"    swap r25\n" \
+"    eor r25, r20\n" \
+"    andi r25, 0x0f\n" \
+"    eor r20, r25\n" \
+"    swap r25\n" \
+"    eor r24, r25\n" \
+"    st Z+, r0\n" \
+"    st Z+, r2\n" \
+"    st Z+, r3\n" \
+"    st Z+, r4\n" \
+"    st Z+, r5\n" \
+"    st Z+, r6\n" \
+"    st Z+, r7\n" \
+"    st Z+, r8\n" \
+"    st Z+, r9\n" \
+"    st Z+, r10\n" \
+"    st Z+, r11\n" \
+"    st Z+, r12\n" \
+"    st Z+, r13\n" \
+"    st Z+, r14\n" \
+"    st Z+, r15\n" \
+"    st Z+, r16\n" \
+"    st Z+, r17\n" \
+"    st Z+, r18\n" \
+"    st Z+, r19\n" \
+"    st Z+, r20\n" \
+"    st Z+, r21\n" \
+"    st Z+, r22\n" \
+"    st Z+, r23\n" \
+"    st Z+, r24\n" \
+"2:  sbiw %A[len], 1        ; decrement loop counter, set flags\n" \
+"    brlt 3f\n" \
+"    rjmp 1b                ; loop if required\n" \
+"3:\n" \
 : \
-: [rgb0] "r" (RGB0), \
-  [rgb1] "r" (RGB1), \
-  [rgb2] "e" (RGB2), \
-  [rgb3] "e" (RGB3), \
-  [len] "r" (LEN), \
-  [port] "I" (_SFR_IO_ADDR(PORT)), \
-  [pin0] "I" (PIN0), \
-  [pin1] "I" (PIN1), \
-  [pin2] "I" (PIN2), \
-  [pin3] "I" (PIN3) \
-: "r15", "r16", "r18", "r19", "r20", "r21", "r22", "r23", \
-  "r24", "r25", "r26", "r27", \
-  "cc", "memory" \
+: [rgb] "z" (RGB), \
+  [len] "w" (LEN) \
+: "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11", "r12", \
+  "r13", "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r21", "r22", \
+  "r23", "r24", "r25", "cc", "memory" \
 )
+#else
+/* Portable version of the above, using the same transposition steps. */
+static inline void WS2811_transpose_8(RGB_t *rgb, uint16_t len) {
+    uint8_t *row = (uint8_t *) rgb;
+
+    while (len--) {
+        uint8_t x[24], t;
+        uint8_t c, j;
+
+        for (c = 0; c < 3; c++) {
+            for (j = 0; j < 8; j++)
+                x[c * 8 + j] = row[(7 - j) * 3 + c];
+        }
+        for (c = 0; c < 24; c += 8) {
+            for (j = c; j < c + 8; j += 2) {
+                t = (x[j] ^ (x[j + 1] >> 1)) & 0x55;
+                x[j] ^= t;
+                x[j + 1] ^= t << 1;
+            }
+            for (j = c; j < c + 8; j += (j & 1) ? 3 : 1) {
+                t = (x[j] ^ (x[j + 2] >> 2)) & 0x33;
+                x[j] ^= t;
+                x[j + 2] ^= t << 2;
+            }
+            for (j = c; j < c + 4; j++) {
+                t = (x[j] ^ (x[j + 4] >> 4)) & 0x0f;
+                x[j] ^= t;
+                x[j + 4] ^= t << 4;
+            }
+        }
+        for (j = 0; j < 24; j++)
+            *row++ = x[j];
+    }
+}
+#define WS2811_TRANSPOSE_8(RGB, LEN) WS2811_transpose_8(RGB, LEN)
+#endif
 
 /*
- * 7 parallel outputs should also be possible with the loop looking something
- * like the following, but may require all iterations to be unrolled or some
- * other trick to save enough cycles to load the bytes to be output into r16,
- * r17, r18, r19, r20, r21, r22.  This gets quite tricky.
-"    ori r25, 0xff\n" \
-"1:  out %[port], r25       ; pins lo -> hi\n" \
-"    lsl r16                ; shift stream 0 byte to next bit, set Carry\n" \
-"    rol r24                ; load Carry into pin0\n" \
-"    lsl r22                ; shift stream 6 byte to next bit, set Carry\n" \
-"    out %[port], r24       ; pins hi -> colour output bit\n" \
-"    rol r24                ; load Carry into pin6\n" \
-"    lsl r21                ; shift stream 5 byte to next bit, set Carry\n" \
-"    rol r24                ; load Carry into pin5\n" \
-"    lsl r20                ; shift stream 4 byte to next bit, set Carry\n" \
-"    rol r24                ; load Carry into pin4\n" \
-"    lsl r19                ; shift stream 3 byte to next bit, set Carry\n" \
-"    rol r24                ; load Carry into pin3\n" \
-"    lsl r18                ; shift stream 2 byte to next bit, set Carry\n" \
-"    rol r24                ; load Carry into pin2\n" \
-"    lsl r17                ; shift stream 1 byte to next bit, set Carry\n" \
-"    rol r24                ; load Carry into pin1\n" \
-"    out %[port], __zero_reg__ ; pins hi -> lo if not already low\n" \
-"    dec r15                ; decrement loop counter, set flags\n" \
-"    brne 1b                ; (inner) loop if required\n" \
-"    ldi r15, 7             ; reload inner loop counter\n" \
+ * Same as WS2811_TRANSPOSE_8 for eight strips kept in separate buffers:
+ * RGB[n] points to the LEN pixels of the strip on pin n, or is 0 for an
+ * unused pin, and the LEN * 24 slices are written to SLICES.  The pixels
+ * are copied into rows in SLICES first, which are then converted in
+ * place, so this takes a copy of the pixels longer.
+ */
+static inline void WS2811_transpose_8_strips(uint8_t *slices,
+        const RGB_t *const rgb[8], uint16_t len) {
+    RGB_t *row = (RGB_t *) slices;
+    static const RGB_t off = { 0, 0, 0 };
+    uint16_t i;
+    uint8_t n;
+
+    for (i = 0; i < len; i++)
+        for (n = 0; n < 8; n++)
+            *row++ = rgb[n] ? rgb[n][i] : off;
+    WS2811_TRANSPOSE_8((RGB_t *) slices, len);
+}
+#endif /* WS2811_PIXEL_BYTES == 3 */
+
+/* Keep interrupts disabled across several calls, saving the state in S. */
+#ifdef __AVR__
+#define WS2811_IRQ_SAVE(S) uint8_t S = SREG; asm volatile("cli" ::: "memory")
+#define WS2811_IRQ_RESTORE(S) SREG = (S)
+#endif
+
+#if F_CPU == 16000000
+/*
+ * Output LEN pixels from RGB through USART N (0 for USART0 and so on)
+ * running in master SPI mode, instead of bit-banging, with interrupts
+ * left enabled.  Every bit becomes 5 SPI bits at 4MHz, 10000 for a 0 and
+ * 11110 for a 1, the same 250ns / 1000ns timing as the other routines,
+ * so each byte is sent as 5 USART bytes looked up a nibble at a time in
+ * WS2811_usart_hi and WS2811_usart_lo.  The strip is connected to TXDn,
+ * XCKn has to be configured as an output for master mode (it carries the
+ * unused clock), and WS2811_USART_INIT(N) sets the USART up, e.g. PD1 and
+ * PD4 for USART0 on the atmega328p.
+ * The CPU only polls the USART between bytes, so interrupt handlers run
+ * as usual as long as they return within about 2us, the one byte the
+ * USART buffers.  A longer one lets it run dry, stretching the current
+ * bit, which the strips take as the reset after WS2811_MAX_GAP_US.  The
+ * call returns once the last byte has been shifted out (TXCn set), so the
+ * reset gap can be timed from there.  Only available at 16MHz, where
+ * F_CPU divides into the 4MHz SPI clock and leaves the loop most of each
+ * 2us to fetch the next byte.
  */
+static const uint8_t WS2811_usart_hi[16][3] PROGMEM = {
+    { 0x84, 0x21, 0x00 }, { 0x84, 0x21, 0xe0 },
+    { 0x84, 0x3d, 0x00 }, { 0x84, 0x3d, 0xe0 },
+    { 0x87, 0xa1, 0x00 }, { 0x87, 0xa1, 0xe0 },
+    { 0x87, 0xbd, 0x00 }, { 0x87, 0xbd, 0xe0 },
+    { 0xf4, 0x21, 0x00 }, { 0xf4, 0x21, 0xe0 },
+    { 0xf4, 0x3d, 0x00 }, { 0xf4, 0x3d, 0xe0 },
+    { 0xf7, 0xa1, 0x00 }, { 0xf7, 0xa1, 0xe0 },
+    { 0xf7, 0xbd, 0x00 }, { 0xf7, 0xbd, 0xe0 },
+};
+static const uint8_t WS2811_usart_lo[16][3] PROGMEM = {
+    { 0x08, 0x42, 0x10 }, { 0x08, 0x42, 0x1e },
+    { 0x08, 0x43, 0xd0 }, { 0x08, 0x43, 0xde },
+    { 0x08, 0x7a, 0x10 }, { 0x08, 0x7a, 0x1e },
+    { 0x08, 0x7b, 0xd0 }, { 0x08, 0x7b, 0xde },
+    { 0x0f, 0x42, 0x10 }, { 0x0f, 0x42, 0x1e },
+    { 0x0f, 0x43, 0xd0 }, { 0x0f, 0x43, 0xde },
+    { 0x0f, 0x7a, 0x10 }, { 0x0f, 0x7a, 0x1e },
+    { 0x0f, 0x7b, 0xd0 }, { 0x0f, 0x7b, 0xde },
+};
+
+#ifdef __AVR__
+#define WS2811_USART_INIT(N) do { \
+    UBRR##N = 0; \
+    UCSR##N##C = _BV(UMSEL##N##1) | _BV(UMSEL##N##0); \
+    UCSR##N##B = _BV(TXEN##N); \
+    UBRR##N = F_CPU / 8000000 - 1; \
+} while (0)
+
+#define WS2811_USART_PUT(N, V) do { \
+    uint8_t v_ = (V); \
+    loop_until_bit_is_set(UCSR##N##A, UDRE##N); \
+    UDR##N = v_; \
+} while (0)
+
+#define WS2811_OUT_1_USART(N, RGB, LEN) do { \
+    const uint8_t *p_ = (const uint8_t *) (RGB); \
+    uint16_t n_ = (LEN) * WS2811_PIXEL_BYTES; \
+    if (n_) { \
+        while (n_--) { \
+            const uint8_t *hi_ = WS2811_usart_hi[*p_ >> 4]; \
+            const uint8_t *lo_ = WS2811_usart_lo[*p_++ & 15]; \
+            WS2811_USART_PUT(N, pgm_read_byte(hi_)); \
+            WS2811_USART_PUT(N, pgm_read_byte(hi_ + 1)); \
+            WS2811_USART_PUT(N, pgm_read_byte(hi_ + 2) | pgm_read_byte(lo_)); \
+            WS2811_USART_PUT(N, pgm_read_byte(lo_ + 1)); \
+            if (!n_) \
+                UCSR##N##A = _BV(TXC##N); /* cleared by writing a 1 */ \
+            WS2811_USART_PUT(N, pgm_read_byte(lo_ + 2)); \
+        } \
+        loop_until_bit_is_set(UCSR##N##A, TXC##N); \
+    } \
+} while (0)
+#else
+#define WS2811_USART_INIT(N) ((void) 0)
+
+#define WS2811_OUT_1_USART(N, RGB, LEN) do { \
+    WS2811_host_frame_t f_; \
+    f_.nstrips = 0; \
+    WS2811_host_strip(&f_, "USART" #N, 0, RGB, WS2811_PIXEL_BYTES); \
+    WS2811_host_emit(&f_, LEN, 0); \
+} while (0)
+#endif
+#endif
 
 /*
  * Define C functions to wrap the inline WS2811 macro for given ports and pins.
@@ -419,6 +6179,10 @@ asm volatile( \
 extern void NAME(const RGB_t *rgb, uint16_t len) __attribute__((noinline)); \
 void NAME(const RGB_t *rgb, uint16_t len) { WS2811_OUT_1(PORT, PIN, rgb, len); }
 
+#define DEFINE_WS2811_OUT_1_USART_FN(NAME, N) \
+extern void NAME(const RGB_t *rgb, uint16_t len) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb, uint16_t len) { WS2811_OUT_1_USART(N, rgb, len); }
+
 #define DEFINE_WS2811_OUT_2_FN(NAME, PORT0, PIN0, PORT1, PIN1) \
 extern void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len) \
     __attribute__((noinline)); \
@@ -426,6 +6190,91 @@ void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len) { \
     WS2811_OUT_2(PORT0, PIN0, rgb0, PORT1, PIN1, rgb1, len); \
 }
 
+/*
+ * Same as DEFINE_WS2811_OUT_1_FN but opening an interrupt window every K
+ * pixels, available at 16 and 20MHz.
+ */
+#define DEFINE_WS2811_OUT_1_WINDOW_FN(NAME, PORT, PIN, K) \
+extern void NAME(const RGB_t *rgb, uint16_t len) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb, uint16_t len) { \
+    WS2811_OUT_1_WINDOW(PORT, PIN, rgb, len, K); \
+}
+
+/*
+ * Define C functions wrapping the _SCALE and _LUT variants, available at
+ * 16 and 20MHz.  The brightness or table is passed on every call, e.g.
+ * increment scale between calls for a fade-in.
+ */
+#define DEFINE_WS2811_OUT_1_SCALE_FN(NAME, PORT, PIN) \
+extern void NAME(const RGB_t *rgb, uint16_t len, uint8_t scale) \
+    __attribute__((noinline)); \
+void NAME(const RGB_t *rgb, uint16_t len, uint8_t scale) { \
+    WS2811_OUT_1_SCALE(PORT, PIN, rgb, len, scale); \
+}
+
+#define DEFINE_WS2811_OUT_1_LUT_FN(NAME, PORT, PIN) \
+extern void NAME(const RGB_t *rgb, uint16_t len, const uint8_t *lut) \
+    __attribute__((noinline)); \
+void NAME(const RGB_t *rgb, uint16_t len, const uint8_t *lut) { \
+    WS2811_OUT_1_LUT(PORT, PIN, rgb, len, lut); \
+}
+
+#define DEFINE_WS2811_OUT_2_SCALE_FN(NAME, PORT0, PIN0, PORT1, PIN1) \
+extern void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len, \
+        uint8_t scale) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len, \
+        uint8_t scale) { \
+    WS2811_OUT_2_SCALE(PORT0, PIN0, rgb0, PORT1, PIN1, rgb1, len, scale); \
+}
+
+#define DEFINE_WS2811_OUT_2_LUT_FN(NAME, PORT0, PIN0, PORT1, PIN1) \
+extern void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len, \
+        const uint8_t *lut) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len, \
+        const uint8_t *lut) { \
+    WS2811_OUT_2_LUT(PORT0, PIN0, rgb0, PORT1, PIN1, rgb1, len, lut); \
+}
+
+/*
+ * Define C functions outputting a solid colour or a gradient without a
+ * pixel buffer, available at 16 and 20MHz.
+ */
+#define DEFINE_WS2811_OUT_1_FILL_FN(NAME, PORT, PIN) \
+extern void NAME(RGB_t rgb, uint16_t len) __attribute__((noinline)); \
+void NAME(RGB_t rgb, uint16_t len) { WS2811_OUT_1_FILL(PORT, PIN, rgb, len); }
+
+#define DEFINE_WS2811_OUT_1_GRADIENT_FN(NAME, PORT, PIN) \
+extern void NAME(RGB_t from, RGB_t to, uint16_t len) \
+    __attribute__((noinline)); \
+void NAME(RGB_t from, RGB_t to, uint16_t len) { \
+    WS2811_OUT_1_GRADIENT(PORT, PIN, from, to, len); \
+}
+
+/*
+ * Define C functions wrapping the palette routines, available at 16 and
+ * 20MHz.  idx holds len indices, 8 or 4 bits each.
+ */
+#define DEFINE_WS2811_OUT_1_PAL8_FN(NAME, PORT, PIN) \
+extern void NAME(const uint8_t *idx, uint16_t len, const RGB_t *pal) \
+    __attribute__((noinline)); \
+void NAME(const uint8_t *idx, uint16_t len, const RGB_t *pal) { \
+    WS2811_OUT_1_PAL8(PORT, PIN, idx, len, pal); \
+}
+
+#define DEFINE_WS2811_OUT_1_PAL4_FN(NAME, PORT, PIN) \
+extern void NAME(const uint8_t *idx, uint16_t len, const RGB_t *pal) \
+    __attribute__((noinline)); \
+void NAME(const uint8_t *idx, uint16_t len, const RGB_t *pal) { \
+    WS2811_OUT_1_PAL4(PORT, PIN, idx, len, pal); \
+}
+
+#define DEFINE_WS2811_OUT_2_COMMON_FN(NAME, PORT, PIN0, PIN1) \
+extern void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len) \
+    __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len) { \
+    WS2811_OUT_2_COMMON(PORT, PIN0, rgb0, PIN1, rgb1, len); \
+}
+
 #define DEFINE_WS2811_OUT_3_COMMON_FN(NAME, PORT, PIN0, PIN1, PIN2) \
 extern void NAME(const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2, \
         uint16_t len) __attribute__((noinline)); \
@@ -443,4 +6292,995 @@ void NAME(const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2, \
             len); \
 }
 
+/*
+ * Define a C function wrapping WS2811_OUT_4_MASK, available at 16 and
+ * 20MHz.  One function serves every combination of pins on PORT.
+ */
+#define DEFINE_WS2811_OUT_4_MASK_FN(NAME, PORT) \
+extern void NAME(uint8_t mask0, const RGB_t *rgb0, uint8_t mask1, \
+        const RGB_t *rgb1, uint8_t mask2, const RGB_t *rgb2, uint8_t mask3, \
+        const RGB_t *rgb3, uint16_t len) __attribute__((noinline)); \
+void NAME(uint8_t mask0, const RGB_t *rgb0, uint8_t mask1, \
+        const RGB_t *rgb1, uint8_t mask2, const RGB_t *rgb2, uint8_t mask3, \
+        const RGB_t *rgb3, uint16_t len) { \
+    WS2811_OUT_4_MASK(PORT, mask0, rgb0, mask1, rgb1, mask2, rgb2, mask3, \
+            rgb3, len); \
+}
+
+/*
+ * Define C functions wrapping WS2811_OUT_2_2 and WS2811_OUT_3_1, available
+ * at 16 and 20MHz.
+ */
+#define DEFINE_WS2811_OUT_2_2_FN(NAME, PORT0, PIN0, PIN1, PORT1, PIN2, PIN3) \
+extern void NAME(const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2, \
+        const RGB_t *rgb3, uint16_t len) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2, \
+        const RGB_t *rgb3, uint16_t len) { \
+    WS2811_OUT_2_2(PORT0, PIN0, rgb0, PIN1, rgb1, PORT1, PIN2, rgb2, PIN3, \
+            rgb3, len); \
+}
+
+#define DEFINE_WS2811_OUT_3_1_FN(NAME, PORT0, PIN0, PIN1, PIN2, PORT1, PIN3) \
+extern void NAME(const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2, \
+        const RGB_t *rgb3, uint16_t len) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2, \
+        const RGB_t *rgb3, uint16_t len) { \
+    WS2811_OUT_3_1(PORT0, PIN0, rgb0, PIN1, rgb1, PIN2, rgb2, PORT1, PIN3, \
+            rgb3, len); \
+}
+
+/*
+ * Define C functions taking a separate length for each stream.  All streams
+ * are output in parallel while they all have data left, then the longer
+ * ones continue with the narrower routines, so no padding is needed and
+ * the pins of the streams that have run out stay low.  Interrupts are kept
+ * disabled for the whole frame so that the few microseconds between the
+ * routines can't turn into a reset (latch) period.  Counting the listings
+ * at 16MHz, a strip that continues into the next routine is low for 14
+ * cycles after its last bit plus the 20 (WS2811_OUT_1) to 41
+ * (WS2811_OUT_4_COMMON) cycles before the next routine's first bit, 17
+ * and 24 to 45 at 20MHz.  The call in between adds an estimated 25
+ * cycles of ret, register restores and saves, argument moves and call,
+ * depending on the compiler, so the longest gap, WS2811_OUT_4_COMMON to
+ * WS2811_OUT_3_COMMON, is about 78 cycles (4.9us) at 16MHz, just under
+ * WS2811_MAX_GAP_US, and 85 cycles (4.3us) at 20MHz.  The pointers into
+ * the streams are computed before the first routine to keep that short.
+ * tests/timing.c checks the chains under simavr.
+ * In the _COMMON variants the streams must be sorted from the longest to
+ * the shortest (len0 >= len1 >= ...), as the narrower routines only
+ * drive the first pins.  That is checked with assert() unless NDEBUG is
+ * defined, otherwise any pixels a stream has beyond the length of the
+ * stream before it are dropped.
+ */
+#define DEFINE_WS2811_OUT_2_LENS_FN(NAME, PORT0, PIN0, PORT1, PIN1) \
+DEFINE_WS2811_OUT_2_FN(NAME##_2, PORT0, PIN0, PORT1, PIN1) \
+DEFINE_WS2811_OUT_1_FN(NAME##_0, PORT0, PIN0) \
+DEFINE_WS2811_OUT_1_FN(NAME##_1, PORT1, PIN1) \
+extern void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1) { \
+    WS2811_IRQ_SAVE(sreg); \
+    if (len0 >= len1) { \
+        NAME##_2(rgb0, rgb1, len1); \
+        NAME##_0(rgb0 + len1, len0 - len1); \
+    } else { \
+        NAME##_2(rgb0, rgb1, len0); \
+        NAME##_1(rgb1 + len0, len1 - len0); \
+    } \
+    WS2811_IRQ_RESTORE(sreg); \
+}
+
+#define DEFINE_WS2811_OUT_2_COMMON_LENS_FN(NAME, PORT, PIN0, PIN1) \
+DEFINE_WS2811_OUT_2_COMMON_FN(NAME##_2, PORT, PIN0, PIN1) \
+DEFINE_WS2811_OUT_1_FN(NAME##_1, PORT, PIN0) \
+extern void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1) { \
+    assert(len1 <= len0); \
+    if (len1 > len0) \
+        len1 = len0; \
+    const RGB_t *tail0 = rgb0 + len1; \
+    WS2811_IRQ_SAVE(sreg); \
+    NAME##_2(rgb0, rgb1, len1); \
+    NAME##_1(tail0, len0 - len1); \
+    WS2811_IRQ_RESTORE(sreg); \
+}
+
+#define DEFINE_WS2811_OUT_3_COMMON_LENS_FN(NAME, PORT, PIN0, PIN1, PIN2) \
+DEFINE_WS2811_OUT_3_COMMON_FN(NAME##_3, PORT, PIN0, PIN1, PIN2) \
+DEFINE_WS2811_OUT_2_COMMON_FN(NAME##_2, PORT, PIN0, PIN1) \
+DEFINE_WS2811_OUT_1_FN(NAME##_1, PORT, PIN0) \
+extern void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1, const RGB_t *rgb2, uint16_t len2) \
+    __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1, const RGB_t *rgb2, uint16_t len2) { \
+    assert(len1 <= len0 && len2 <= len1); \
+    if (len1 > len0) \
+        len1 = len0; \
+    if (len2 > len1) \
+        len2 = len1; \
+    const RGB_t *mid0 = rgb0 + len2, *mid1 = rgb1 + len2; \
+    const RGB_t *tail0 = rgb0 + len1; \
+    WS2811_IRQ_SAVE(sreg); \
+    NAME##_3(rgb0, rgb1, rgb2, len2); \
+    NAME##_2(mid0, mid1, len1 - len2); \
+    NAME##_1(tail0, len0 - len1); \
+    WS2811_IRQ_RESTORE(sreg); \
+}
+
+#define DEFINE_WS2811_OUT_4_COMMON_LENS_FN(NAME, PORT, PIN0, PIN1, PIN2, PIN3) \
+DEFINE_WS2811_OUT_4_COMMON_FN(NAME##_4, PORT, PIN0, PIN1, PIN2, PIN3) \
+DEFINE_WS2811_OUT_3_COMMON_FN(NAME##_3, PORT, PIN0, PIN1, PIN2) \
+DEFINE_WS2811_OUT_2_COMMON_FN(NAME##_2, PORT, PIN0, PIN1) \
+DEFINE_WS2811_OUT_1_FN(NAME##_1, PORT, PIN0) \
+extern void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1, const RGB_t *rgb2, uint16_t len2, const RGB_t *rgb3, \
+        uint16_t len3) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb0, uint16_t len0, const RGB_t *rgb1, \
+        uint16_t len1, const RGB_t *rgb2, uint16_t len2, const RGB_t *rgb3, \
+        uint16_t len3) { \
+    assert(len1 <= len0 && len2 <= len1 && len3 <= len2); \
+    if (len1 > len0) \
+        len1 = len0; \
+    if (len2 > len1) \
+        len2 = len1; \
+    if (len3 > len2) \
+        len3 = len2; \
+    const RGB_t *mid0 = rgb0 + len3, *mid1 = rgb1 + len3; \
+    const RGB_t *mid2 = rgb2 + len3; \
+    const RGB_t *end0 = rgb0 + len2, *end1 = rgb1 + len2; \
+    const RGB_t *tail0 = rgb0 + len1; \
+    WS2811_IRQ_SAVE(sreg); \
+    NAME##_4(rgb0, rgb1, rgb2, rgb3, len3); \
+    NAME##_3(mid0, mid1, mid2, len2 - len3); \
+    NAME##_2(end0, end1, len1 - len2); \
+    NAME##_1(tail0, len0 - len1); \
+    WS2811_IRQ_RESTORE(sreg); \
+}
+
+#define DEFINE_WS2811_OUT_7_COMMON_FN(NAME, PORT, PIN0, PIN1, PIN2, PIN3, PIN4, \
+        PIN5, PIN6) \
+extern void NAME(const RGB_t *rgb, uint16_t len) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb, uint16_t len) { \
+    WS2811_OUT_7_COMMON(PORT, PIN0, PIN1, PIN2, PIN3, PIN4, PIN5, PIN6, rgb, \
+            len); \
+}
+
+#define DEFINE_WS2811_OUT_8_COMMON_FN(NAME, PORT) \
+extern void NAME(const RGB_t *rgb, uint16_t len) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb, uint16_t len) { \
+    WS2811_OUT_8_COMMON(PORT, rgb, len); \
+}
+
+#define DEFINE_WS2811_OUT_8_PACKED_FN(NAME, PORT) \
+extern void NAME(const uint8_t *data, uint16_t len) __attribute__((noinline)); \
+void NAME(const uint8_t *data, uint16_t len) { \
+    WS2811_OUT_8_PACKED(PORT, data, len); \
+}
+
+#define DEFINE_WS2811_OUT_16_PACKED_FN(NAME, PORT0, PORT1) \
+extern void NAME(const uint8_t *data0, const uint8_t *data1, uint16_t len) \
+    __attribute__((noinline)); \
+void NAME(const uint8_t *data0, const uint8_t *data1, uint16_t len) { \
+    WS2811_OUT_16_PACKED(PORT0, data0, PORT1, data1, len); \
+}
+
+/*
+ * Define C functions wrapping the flash routines, available at 16 and
+ * 20MHz.  The pointers are flash addresses, e.g. of PROGMEM arrays, with
+ * the streams interleaved as described above for the multi-stream ones.
+ */
+#define DEFINE_WS2811_OUT_1_P_FN(NAME, PORT, PIN) \
+extern void NAME(const RGB_t *rgb, uint16_t len) __attribute__((noinline)); \
+void NAME(const RGB_t *rgb, uint16_t len) { \
+    WS2811_OUT_1_P(PORT, PIN, rgb, len); \
+}
+
+#define DEFINE_WS2811_OUT_1_RLE_FN(NAME, PORT, PIN) \
+extern void NAME(const uint8_t *data, uint16_t len) __attribute__((noinline)); \
+void NAME(const uint8_t *data, uint16_t len) { \
+    WS2811_OUT_1_RLE(PORT, PIN, data, len); \
+}
+
+#define DEFINE_WS2811_OUT_2_P_FN(NAME, PORT0, PIN0, PORT1, PIN1) \
+extern void NAME(const uint8_t *data, uint16_t len) __attribute__((noinline)); \
+void NAME(const uint8_t *data, uint16_t len) { \
+    WS2811_OUT_2_P(PORT0, PIN0, PORT1, PIN1, data, len); \
+}
+
+#define DEFINE_WS2811_OUT_4_COMMON_P_FN(NAME, PORT, PIN0, PIN1, PIN2, PIN3) \
+extern void NAME(const uint8_t *data, uint16_t len) __attribute__((noinline)); \
+void NAME(const uint8_t *data, uint16_t len) { \
+    WS2811_OUT_4_COMMON_P(PORT, PIN0, PIN1, PIN2, PIN3, data, len); \
+}
+
+#define DEFINE_WS2811_OUT_8_PACKED_P_FN(NAME, PORT) \
+extern void NAME(const uint8_t *data, uint16_t len) __attribute__((noinline)); \
+void NAME(const uint8_t *data, uint16_t len) { \
+    WS2811_OUT_8_PACKED_P(PORT, data, len); \
+}
+
+#define DEFINE_WS2811_OUT_16_PACKED_P_FN(NAME, PORT0, PORT1) \
+extern void NAME(const uint8_t *data, uint16_t len) __attribute__((noinline)); \
+void NAME(const uint8_t *data, uint16_t len) { \
+    WS2811_OUT_16_PACKED_P(PORT0, PORT1, data, len); \
+}
+
+#define DEFINE_WS2811_TRANSPOSE_8_FN(NAME) \
+extern void NAME(RGB_t *rgb, uint16_t len) __attribute__((noinline)); \
+void NAME(RGB_t *rgb, uint16_t len) { WS2811_TRANSPOSE_8(rgb, len); }
+
+/*
+ * Frame buffer for one strip that keeps track of how far the pixels have
+ * been changed since they were last output.  The strips latch whatever
+ * prefix of the frame they receive, so only the pixels up to the last
+ * changed one need to be sent: an effect that only touches the first 20
+ * pixels of a 100-pixel strip refreshes five times as often.
+ * Change the pixels with WS2811_fb_set(), or write to fb->rgb directly and
+ * call WS2811_fb_touch() with the highest index written.  For
+ * WS2811_OUT_7_COMMON fb->rgb points to the RGB_t [LEN][7] rows (and for
+ * WS2811_OUT_8_COMMON, at 20MHz only, to the RGB_t [LEN][8] rows) and the
+ * indices are row numbers.
+ */
+typedef struct {
+    RGB_t *rgb;
+    uint16_t len;                   /* pixels in the buffer */
+    uint16_t dirty;                 /* pixels that need to be output */
+} WS2811_fb_t;
+
+/* The whole buffer is output the first time. */
+static inline void WS2811_fb_init(WS2811_fb_t *fb, RGB_t *rgb,
+        uint16_t len) {
+    fb->rgb = rgb;
+    fb->len = len;
+    fb->dirty = len;
+}
+
+static inline void WS2811_fb_touch(WS2811_fb_t *fb, uint16_t i) {
+    if (i >= fb->dirty)
+        fb->dirty = i + 1;
+}
+
+static inline void WS2811_fb_set(WS2811_fb_t *fb, uint16_t i, RGB_t rgb) {
+    fb->rgb[i] = rgb;
+    WS2811_fb_touch(fb, i);
+}
+
+/* Number of pixels of FB to output when LEN pixels are output in total. */
+static inline uint16_t WS2811_fb_len(const WS2811_fb_t *fb, uint16_t len) {
+    return len < fb->len ? len : fb->len;
+}
+
+/* Mark FB clean if its first LEN pixels, output, include all the changes. */
+static inline void WS2811_fb_clean(WS2811_fb_t *fb, uint16_t len) {
+    if (fb->dirty <= len)
+        fb->dirty = 0;
+}
+
+/*
+ * Double-buffered frame receiver for pixel data sent over a serial line,
+ * so that the next frame is received while the current one is output.
+ * The sender sends frames of LEN * sizeof(RGB_t) bytes (the pixels' bytes
+ * in output order) and one frame may only be sent after each credit
+ * received back, which keeps it from overrunning the buffers.  The two
+ * frames are consecutive in one buffer of 2 * LEN pixels, received into
+ * as a ring: WS2811_RX_ISR(USART_RX_vect, rx, 0) defines the interrupt
+ * handler storing USART0's bytes, WS2811_rx_byte() does the same in C.
+ * All the credits are sent from the main loop, 2 after WS2811_rx_init(),
+ * then one after each frame returned by WS2811_rx_frame() is output and
+ * released with WS2811_rx_done(), e.g.
+ *   if ((rgb = WS2811_rx_frame(&rx))) {
+ *       WS2811RGB(rgb, rx.len);
+ *       WS2811_rx_done(&rx);
+ *       send a credit;
+ *   }
+ * The handler takes one byte per interrupt, so when the output uses
+ * WS2811_OUT_1_WINDOW its windows have to come more often than the
+ * bytes: K * 30us plus the handler's 3.4us below the time of one byte,
+ * K <= 2 at 115200 baud (86.8us a byte), K = 1 at 230400.  The UART's
+ * 2-byte buffer covers the first window and windows taken by other
+ * interrupts now and then.  A byte lost anyway sets lost, after which
+ * no more frames are returned, and a frame cut short by the sender never
+ * completes; either way the sender runs out of credits and
+ * WS2811_rx_sync(), called once the line has been idle for longer than
+ * any pause within a frame, starts over with 2 new credits.
+ * See examples/uartframes.c.
+ */
+typedef struct {
+    uint8_t *volatile ptr;          /* next byte to be received */
+    uint8_t *end;                   /* end of the second frame */
+    uint8_t *start;                 /* start of the first frame */
+    volatile uint8_t wrapped;       /* the second frame is complete */
+    volatile uint8_t lost;          /* the UART overran */
+    uint8_t next;                   /* frame to be output next, 0 or 1 */
+    uint16_t len;                   /* pixels per frame */
+} WS2811_rx_t;
+
+/* BUF holds 2 * LEN pixels.  Returns the number of credits to send. */
+static inline uint8_t WS2811_rx_init(WS2811_rx_t *rx, RGB_t *buf,
+        uint16_t len) {
+    WS2811_IRQ_SAVE(sreg);
+
+    rx->start = (uint8_t *) buf;
+    rx->ptr = rx->start;
+    rx->end = rx->start + 2 * len * sizeof(RGB_t);
+    rx->wrapped = 0;
+    rx->lost = 0;
+    rx->next = 0;
+    rx->len = len;
+    WS2811_IRQ_RESTORE(sreg);
+    return 2;
+}
+
+/* Store a received byte, with interrupts disabled. */
+static inline void WS2811_rx_byte(WS2811_rx_t *rx, uint8_t byte) {
+    uint8_t *ptr = rx->ptr;
+
+    *ptr++ = byte;
+    if (ptr == rx->end) {
+        ptr = rx->start;
+        rx->wrapped = 1;
+    }
+    rx->ptr = ptr;
+}
+
+static inline uint8_t *WS2811_rx_ptr(const WS2811_rx_t *rx) {
+    uint8_t *ptr;
+    WS2811_IRQ_SAVE(sreg);
+
+    ptr = rx->ptr;
+    WS2811_IRQ_RESTORE(sreg);
+    return ptr;
+}
+
+/* The next complete frame or 0.  It stays valid until WS2811_rx_done. */
+static inline RGB_t *WS2811_rx_frame(const WS2811_rx_t *rx) {
+    uint8_t *mid = rx->start + rx->len * sizeof(RGB_t);
+
+    if (rx->lost)
+        return 0;
+    if (rx->next)
+        return rx->wrapped ? (RGB_t *) mid : 0;
+    /* The second frame can't wrap again before its credit is sent. */
+    if (rx->wrapped || WS2811_rx_ptr(rx) >= mid)
+        return (RGB_t *) rx->start;
+    return 0;
+}
+
+/* Release the frame, a credit should be sent afterwards. */
+static inline void WS2811_rx_done(WS2811_rx_t *rx) {
+    if (rx->next)
+        rx->wrapped = 0;
+    rx->next ^= 1;
+}
+
+/*
+ * Call when no frame is ready and no byte has been received for longer
+ * than the sender pauses within a frame.  Drops a partial frame, or the
+ * frames after a lost byte, and returns the number of credits to send.
+ */
+static inline uint8_t WS2811_rx_sync(WS2811_rx_t *rx) {
+    uint8_t *ptr = WS2811_rx_ptr(rx);
+
+    if (!rx->lost && (ptr == rx->start ||
+            ptr == rx->start + rx->len * sizeof(RGB_t)))
+        return 0;
+    return WS2811_rx_init(rx, (RGB_t *) rx->start, rx->len);
+}
+
+#ifdef __AVR__
+/*
+ * Interrupt handler for the receive interrupt VECT of USART N storing its
+ * bytes in RX, a WS2811_rx_t variable, like WS2811_rx_byte().  Naked and
+ * leaving SREG alone (no instruction below changes it), so that its time
+ * can be counted: 7 cycles to enter, 34, 38 or 44 cycles of code below
+ * (44 when the ring wraps) and 4 for reti, at most 55 cycles or 3.4us at
+ * 16MHz.  In a window of WS2811_OUT_1_WINDOW after a 0 bit the strip sees
+ * a low period of 16 + 5 + 55 = 76 cycles, 4.75us (20 + 5 + 55 = 80
+ * cycles, 4us at 20MHz), within WS2811_MAX_GAP_US.
+ * Needs <avr/interrupt.h>.
+ */
+#define WS2811_RX_ISR(VECT, RX, N) \
+ISR(VECT, ISR_NAKED) \
+{ \
+asm volatile( \
+"    push r24\n" \
+"    push r30\n" \
+"    push r31\n" \
+"    lds r24, %[ucsra]    ; status of the byte in UDR, read first\n" \
+"    sbrc r24, %[dor]     ; skip if no byte was lost before it\n" \
+"    sts %[lost], r24     ; nonzero with DOR set\n" \
+"    lds r30, %[ptr]      ; load the next byte's address\n" \
+"    lds r31, %[ptr]+1\n" \
+"    lds r24, %[udr]      ; read the byte, clears RXC\n" \
+"    st Z+, r24\n" \
+"    lds r24, %[end]      ; cpse compares without changing SREG\n" \
+"    cpse r30, r24\n" \
+"    rjmp 1f\n" \
+"    lds r24, %[end]+1\n" \
+"    cpse r31, r24\n" \
+"    rjmp 1f\n" \
+"    lds r30, %[start]    ; second frame complete, wrap around\n" \
+"    lds r31, %[start]+1\n" \
+"    ldi r24, 1\n" \
+"    sts %[wrapped], r24\n" \
+"1:  sts %[ptr], r30\n" \
+"    sts %[ptr]+1, r31\n" \
+"    pop r31\n" \
+"    pop r30\n" \
+"    pop r24\n" \
+"    reti\n" \
+: \
+: [ptr] "i" (&(RX).ptr), \
+  [end] "i" (&(RX).end), \
+  [start] "i" (&(RX).start), \
+  [wrapped] "i" (&(RX).wrapped), \
+  [lost] "i" (&(RX).lost), \
+  [ucsra] "n" (_SFR_MEM_ADDR(UCSR##N##A)), \
+  [udr] "n" (_SFR_MEM_ADDR(UDR##N)), \
+  [dor] "I" (DOR##N) \
+); \
+}
+#endif
+
+/*
+ * Frame scheduler timing the output with a hardware timer: Timer1, free
+ * running at F_CPU / WS2811_TIMER_PRESCALE, by default.  To share a timer
+ * the program already runs define WS2811_TIMER_NOW() to read its 16-bit
+ * count and WS2811_TIMER_PRESCALE to its prescaler, then the scheduler
+ * leaves Timer1 alone.  On parts without a 16-bit Timer1, like the
+ * ATtiny85 and ATtiny13, the scheduler is only defined if
+ * WS2811_TIMER_NOW is.  The timer keeps counting while the output
+ * routines have interrupts disabled, which is what allows measuring
+ * them, but its count is only extended to 32 bits when read, so the
+ * scheduler needs to be called at least every 65536 ticks (32.7ms at
+ * 16MHz with the default prescaler of 8), through WS2811_sched_now()
+ * during longer computations.  The same goes for the output itself: one
+ * taking longer, e.g. over about 1090 pixels per strip with those
+ * settings, is measured 65536 ticks short in last_cycles and max_cycles
+ * and its reset gap starts early, so use a prescaler of 64 for those.
+ * Each output is bracketed by WS2811_sched_wait() and WS2811_sched_done(),
+ * e.g.
+ *   WS2811_SCHED(&sched, WS2811RGB(rgb, LEN));
+ * and starts one frame period after the previous one.  Only if the
+ * strips have not been idle for WS2811_RESET_US since the last output
+ * (or WS2811_sched_init(), some WS2812B variants need 280us) does it wait
+ * for the reset gap too.
+ * A frame started after its deadline counts as missed and the schedule
+ * restarts from it rather than trying to catch up.
+ */
+#ifndef WS2811_TIMER_PRESCALE
+# define WS2811_TIMER_PRESCALE 8
+#endif
+#ifndef WS2811_RESET_US
+# define WS2811_RESET_US 50
+#endif
+#ifndef WS2811_SCHED_WINDOW
+# define WS2811_SCHED_WINDOW 64     /* frames per FPS measurement */
+#endif
+#define WS2811_TIMER_HZ (F_CPU / WS2811_TIMER_PRESCALE)
+/* Timer ticks in US microseconds, rounded up. */
+#define WS2811_TIMER_TICKS(US) \
+    (((uint32_t) (US) * (F_CPU / 1000000) + WS2811_TIMER_PRESCALE - 1) / \
+     WS2811_TIMER_PRESCALE)
+
+#ifndef WS2811_TIMER_NOW
+# if defined(__AVR__) && defined(TCCR1B)
+#  if WS2811_TIMER_PRESCALE == 1
+#   define WS2811_TIMER_CS _BV(CS10)
+#  elif WS2811_TIMER_PRESCALE == 8
+#   define WS2811_TIMER_CS _BV(CS11)
+#  elif WS2811_TIMER_PRESCALE == 64
+#   define WS2811_TIMER_CS (_BV(CS11) | _BV(CS10))
+#  elif WS2811_TIMER_PRESCALE == 256
+#   define WS2811_TIMER_CS _BV(CS12)
+#  elif WS2811_TIMER_PRESCALE == 1024
+#   define WS2811_TIMER_CS (_BV(CS12) | _BV(CS10))
+#  else
+#   error "WS2811_TIMER_PRESCALE must be 1, 8, 64, 256 or 1024 for Timer1"
+#  endif
+#  define WS2811_TIMER_NOW() TCNT1
+#  define WS2811_TIMER_START() (TCCR1A = 0, TCCR1B = WS2811_TIMER_CS)
+# elif !defined(__AVR__)
+/* Host build: the timer follows WS2811_host_cycles, each read taking 4. */
+__attribute__((weak)) uint32_t WS2811_host_idle;
+
+static inline uint16_t WS2811_host_timer(void) {
+    WS2811_host_idle += 4;
+    return (uint16_t) ((WS2811_host_cycles + WS2811_host_idle) /
+            WS2811_TIMER_PRESCALE);
+}
+#  define WS2811_TIMER_NOW() WS2811_host_timer()
+#  define WS2811_TIMER_START() ((void) 0)
+# endif
+#endif
+#ifdef WS2811_TIMER_NOW
+#ifndef WS2811_TIMER_START
+# define WS2811_TIMER_START() ((void) 0)
+#endif
+
+typedef struct {
+    uint32_t period;                /* ticks per frame, 0 for no pacing */
+    uint32_t now;                   /* ticks since WS2811_sched_init() */
+    uint32_t next;                  /* deadline of the next frame */
+    uint32_t start;                 /* start of the last output */
+    uint32_t end;                   /* end of the last output */
+    uint32_t window;                /* start of the FPS measurement */
+    uint32_t last_cycles;           /* duration of the last output */
+    uint32_t max_cycles;            /* duration of the longest output */
+    uint32_t frames;                /* outputs done */
+    uint16_t missed;                /* frames started after their deadline */
+    uint16_t fps;                   /* frames per second, 0 until measured */
+    uint16_t stamp;                 /* timer count at the last read */
+    uint8_t count;                  /* frames started in the window */
+} WS2811_sched_t;
+
+/* The time in ticks, read from the timer. */
+static inline uint32_t WS2811_sched_now(WS2811_sched_t *s) {
+    uint16_t t = WS2811_TIMER_NOW();
+
+    s->now += (uint16_t) (t - s->stamp);
+    s->stamp = t;
+    return s->now;
+}
+
+/* FPS is the frame rate to keep, 0 to output frames as soon as possible. */
+static inline void WS2811_sched_init(WS2811_sched_t *s, uint16_t fps) {
+    WS2811_TIMER_START();
+    s->period = fps ? WS2811_TIMER_HZ / fps : 0;
+    s->now = 0;
+    s->stamp = WS2811_TIMER_NOW();
+    s->next = 0;
+    s->start = 0;
+    s->end = 0;
+    s->window = 0;
+    s->last_cycles = 0;
+    s->max_cycles = 0;
+    s->frames = 0;
+    s->missed = 0;
+    s->fps = 0;
+    s->count = 0;
+}
+
+/* Wait for the next frame's deadline and the reset gap if still needed. */
+static inline void WS2811_sched_wait(WS2811_sched_t *s) {
+    if (s->period) {
+        if ((int32_t) (WS2811_sched_now(s) - s->next) > 0) {
+            if (s->frames)
+                s->missed++;
+            s->next = s->now;
+        }
+        while ((int32_t) (WS2811_sched_now(s) - s->next) < 0)
+            ;
+        s->next += s->period;
+    }
+    while (WS2811_sched_now(s) - s->end < WS2811_TIMER_TICKS(WS2811_RESET_US))
+        ;
+    s->start = s->now;
+    if (s->count == WS2811_SCHED_WINDOW) {
+        s->fps = (uint32_t) WS2811_SCHED_WINDOW * WS2811_TIMER_HZ /
+            (s->start - s->window);
+        s->count = 0;
+    }
+    if (!s->count++)
+        s->window = s->start;
+}
+
+/* Record the output that just ended. */
+static inline void WS2811_sched_done(WS2811_sched_t *s) {
+    s->end = WS2811_sched_now(s);
+    s->last_cycles = (s->end - s->start) * WS2811_TIMER_PRESCALE;
+    if (s->last_cycles > s->max_cycles)
+        s->max_cycles = s->last_cycles;
+    s->frames++;
+}
+
+/* Output a frame with CALL, e.g. a DEFINE_WS2811_*_FN function call. */
+#define WS2811_SCHED(S, CALL) do { \
+    WS2811_sched_wait(S); \
+    CALL; \
+    WS2811_sched_done(S); \
+} while (0)
+#endif /* WS2811_TIMER_NOW */
+
+/*
+ * Define C functions outputting frame buffers up to the last change, i.e.
+ * up to the highest change across all the strips for the multi-strip
+ * functions, and marking them clean.  Nothing is output if nothing has
+ * changed.  The multi-strip functions are based on the _LENS_FN ones so
+ * the buffers can have different lengths, with the same ordering
+ * requirement for the _COMMON variants, fb0->len >= fb1->len >= ...,
+ * checked with assert().  A buffer stays dirty if its changes weren't
+ * all output.
+ */
+#define DEFINE_WS2811_OUT_1_FB_FN(NAME, PORT, PIN) \
+DEFINE_WS2811_OUT_1_FN(NAME##_out, PORT, PIN) \
+extern void NAME(WS2811_fb_t *fb) __attribute__((noinline)); \
+void NAME(WS2811_fb_t *fb) { \
+    uint16_t len = fb->dirty; \
+    fb->dirty = 0; \
+    if (len) \
+        NAME##_out(fb->rgb, len); \
+}
+
+#define DEFINE_WS2811_OUT_2_FB_FN(NAME, PORT0, PIN0, PORT1, PIN1) \
+DEFINE_WS2811_OUT_2_LENS_FN(NAME##_out, PORT0, PIN0, PORT1, PIN1) \
+extern void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1) \
+    __attribute__((noinline)); \
+void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1) { \
+    uint16_t len = fb0->dirty > fb1->dirty ? fb0->dirty : fb1->dirty; \
+    fb0->dirty = fb1->dirty = 0; \
+    if (len) \
+        NAME##_out(fb0->rgb, WS2811_fb_len(fb0, len), \
+                fb1->rgb, WS2811_fb_len(fb1, len)); \
+}
+
+#define DEFINE_WS2811_OUT_2_COMMON_FB_FN(NAME, PORT, PIN0, PIN1) \
+DEFINE_WS2811_OUT_2_COMMON_LENS_FN(NAME##_out, PORT, PIN0, PIN1) \
+extern void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1) \
+    __attribute__((noinline)); \
+void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1) { \
+    uint16_t len = fb0->dirty > fb1->dirty ? fb0->dirty : fb1->dirty; \
+    uint16_t len0 = WS2811_fb_len(fb0, len); \
+    uint16_t len1 = WS2811_fb_len(fb1, len0); \
+    assert(fb1->len <= fb0->len); \
+    if (len) \
+        NAME##_out(fb0->rgb, len0, fb1->rgb, len1); \
+    WS2811_fb_clean(fb0, len0); \
+    WS2811_fb_clean(fb1, len1); \
+}
+
+#define DEFINE_WS2811_OUT_3_COMMON_FB_FN(NAME, PORT, PIN0, PIN1, PIN2) \
+DEFINE_WS2811_OUT_3_COMMON_LENS_FN(NAME##_out, PORT, PIN0, PIN1, PIN2) \
+extern void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1, WS2811_fb_t *fb2) \
+    __attribute__((noinline)); \
+void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1, WS2811_fb_t *fb2) { \
+    uint16_t len = fb0->dirty > fb1->dirty ? fb0->dirty : fb1->dirty; \
+    if (fb2->dirty > len) \
+        len = fb2->dirty; \
+    uint16_t len0 = WS2811_fb_len(fb0, len); \
+    uint16_t len1 = WS2811_fb_len(fb1, len0); \
+    uint16_t len2 = WS2811_fb_len(fb2, len1); \
+    assert(fb1->len <= fb0->len && fb2->len <= fb1->len); \
+    if (len) \
+        NAME##_out(fb0->rgb, len0, fb1->rgb, len1, fb2->rgb, len2); \
+    WS2811_fb_clean(fb0, len0); \
+    WS2811_fb_clean(fb1, len1); \
+    WS2811_fb_clean(fb2, len2); \
+}
+
+#define DEFINE_WS2811_OUT_4_COMMON_FB_FN(NAME, PORT, PIN0, PIN1, PIN2, PIN3) \
+DEFINE_WS2811_OUT_4_COMMON_LENS_FN(NAME##_out, PORT, PIN0, PIN1, PIN2, PIN3) \
+extern void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1, WS2811_fb_t *fb2, \
+        WS2811_fb_t *fb3) __attribute__((noinline)); \
+void NAME(WS2811_fb_t *fb0, WS2811_fb_t *fb1, WS2811_fb_t *fb2, \
+        WS2811_fb_t *fb3) { \
+    uint16_t len = fb0->dirty > fb1->dirty ? fb0->dirty : fb1->dirty; \
+    if (fb2->dirty > len) \
+        len = fb2->dirty; \
+    if (fb3->dirty > len) \
+        len = fb3->dirty; \
+    uint16_t len0 = WS2811_fb_len(fb0, len); \
+    uint16_t len1 = WS2811_fb_len(fb1, len0); \
+    uint16_t len2 = WS2811_fb_len(fb2, len1); \
+    uint16_t len3 = WS2811_fb_len(fb3, len2); \
+    assert(fb1->len <= fb0->len && fb2->len <= fb1->len && \
+            fb3->len <= fb2->len); \
+    if (len) \
+        NAME##_out(fb0->rgb, len0, fb1->rgb, len1, fb2->rgb, len2, \
+                fb3->rgb, len3); \
+    WS2811_fb_clean(fb0, len0); \
+    WS2811_fb_clean(fb1, len1); \
+    WS2811_fb_clean(fb2, len2); \
+    WS2811_fb_clean(fb3, len3); \
+}
+
+#define DEFINE_WS2811_OUT_7_COMMON_FB_FN(NAME, PORT, PIN0, PIN1, PIN2, PIN3, \
+        PIN4, PIN5, PIN6) \
+DEFINE_WS2811_OUT_7_COMMON_FN(NAME##_out, PORT, PIN0, PIN1, PIN2, PIN3, \
+        PIN4, PIN5, PIN6) \
+extern void NAME(WS2811_fb_t *fb) __attribute__((noinline)); \
+void NAME(WS2811_fb_t *fb) { \
+    uint16_t len = fb->dirty; \
+    fb->dirty = 0; \
+    if (len) \
+        NAME##_out(fb->rgb, len); \
+}
+
+#define DEFINE_WS2811_OUT_8_COMMON_FB_FN(NAME, PORT) \
+DEFINE_WS2811_OUT_8_COMMON_FN(NAME##_out, PORT) \
+extern void NAME(WS2811_fb_t *fb) __attribute__((noinline)); \
+void NAME(WS2811_fb_t *fb) { \
+    uint16_t len = fb->dirty; \
+    fb->dirty = 0; \
+    if (len) \
+        NAME##_out(fb->rgb, len); \
+}
+
+#ifdef __cplusplus
+/*
+ * C++ interface choosing the routines at compile time.  A Ws2811Bus lists
+ * the pins the strips are connected to, in any order, e.g.
+ *   typedef Ws2811Bus<Ws2811Pin<Ws2811PortC, 0>, Ws2811Pin<Ws2811PortC, 1>,
+ *           Ws2811Pin<Ws2811PortB, 4> > Bus;
+ *   const RGB_t *rgb[] = { strip0, strip1, strip2 };
+ *   Bus::out(rgb, len);
+ * and out() outputs the pixels of all the strips, rgb[i] for the i'th
+ * pin, with as few routine calls as possible: the pins on a common port
+ * are output 4 at a time with the _COMMON routines, the pins left over
+ * on two ports are combined with WS2811_OUT_2_2 or WS2811_OUT_3_1 where
+ * they add up to 4 and single pins are paired with WS2811_OUT_2.  The
+ * calls follow each other so Bus::kernels calls take Bus::kernels * 30us
+ * per pixel (40us with 4-byte pixels), Bus::pixel_us, which can be
+ * checked with static_assert().  At 8 and 12MHz every pin takes its own
+ * WS2811_OUT_1 call.  With 4-byte pixels the pins left over are only
+ * paired with WS2811_OUT_2.  Each combination of pins gets its own copy
+ * of the routines, there is no runtime cost.
+ * The ports are types declared with WS2811_PORT(NAME, PORT, IO), where IO
+ * is the port's I/O address as a constant, the operand of in and out.
+ * The routines are given _SFR_IO8(io), the same constant expression as
+ * the PORTx macros, so the asm's "I" operands never depend on inlining.
+ * Ws2811PortA to Ws2811PortG are declared for the ports the device has.
+ * In host builds IO is unused.  Needs C++11.
+ */
+#define WS2811_PORT(NAME, PORT, IO) \
+struct NAME { \
+    static const uint8_t io = IO; \
+    static const char *name() { return #PORT; } \
+};
+
+/* avr-libc defines PORTx as _SFR_IO8(IO), so this turns them into IO. */
+#ifdef __AVR__
+# define WS2811_PORT_IO(PORT) PORT
+#else
+# define WS2811_PORT_IO(PORT) 0
+#endif
+#pragma push_macro("_SFR_IO8")
+#undef _SFR_IO8
+#define _SFR_IO8(IO) (IO)
+#ifdef PORTA
+WS2811_PORT(Ws2811PortA, PORTA, WS2811_PORT_IO(PORTA))
+#endif
+#ifdef PORTB
+WS2811_PORT(Ws2811PortB, PORTB, WS2811_PORT_IO(PORTB))
+#endif
+#ifdef PORTC
+WS2811_PORT(Ws2811PortC, PORTC, WS2811_PORT_IO(PORTC))
+#endif
+#ifdef PORTD
+WS2811_PORT(Ws2811PortD, PORTD, WS2811_PORT_IO(PORTD))
+#endif
+#ifdef PORTE
+WS2811_PORT(Ws2811PortE, PORTE, WS2811_PORT_IO(PORTE))
+#endif
+#ifdef PORTF
+WS2811_PORT(Ws2811PortF, PORTF, WS2811_PORT_IO(PORTF))
+#endif
+#ifdef PORTG
+WS2811_PORT(Ws2811PortG, PORTG, WS2811_PORT_IO(PORTG))
+#endif
+#pragma pop_macro("_SFR_IO8")
+#undef WS2811_PORT_IO
+
+template <class PORT, uint8_t BIT> struct Ws2811Pin {
+    typedef PORT port;
+    static const uint8_t bit = BIT;
+};
+
+namespace ws2811_detail {
+
+template <class... T> struct List {};
+
+template <bool C, class A, class B> struct If { typedef A type; };
+template <class A, class B> struct If<false, A, B> { typedef B type; };
+
+template <class A, class B> struct Same { static const bool value = false; };
+template <class A> struct Same<A, A> { static const bool value = true; };
+
+template <class H, class L> struct Prepend;
+template <class H, class... T> struct Prepend<H, List<T...> > {
+    typedef List<H, T...> type;
+};
+
+/* A pin with its position in the Ws2811Bus, i.e. its rgb[] index. */
+template <class PIN, uint8_t INDEX> struct Item {
+    typedef typename PIN::port port;
+    static const uint8_t bit = PIN::bit;
+    static const uint8_t index = INDEX;
+};
+
+template <uint8_t N, class... PINS> struct Number { typedef List<> type; };
+template <uint8_t N, class P, class... PINS> struct Number<N, P, PINS...> {
+    typedef typename Prepend<Item<P, N>,
+            typename Number<N + 1, PINS...>::type>::type type;
+};
+
+/* Number of pins of L on PORT. */
+template <class PORT, class L> struct Count {
+    static const uint8_t value = 0;
+};
+template <class PORT, class H, class... T> struct Count<PORT, List<H, T...> > {
+    static const uint8_t value = Same<PORT, typename H::port>::value +
+        Count<PORT, List<T...> >::value;
+};
+
+/* The first K pins of L on PORT and the other pins. */
+template <class PORT, uint8_t K, class L> struct Take {
+    typedef List<> taken;
+    typedef L rest;
+};
+template <class PORT, uint8_t K, class H, class... T>
+struct Take<PORT, K, List<H, T...> > {
+    static const bool match = K && Same<PORT, typename H::port>::value;
+    typedef Take<PORT, match ? K - 1 : K, List<T...> > next;
+    typedef typename If<match,
+            typename Prepend<H, typename next::taken>::type,
+            typename next::taken>::type taken;
+    typedef typename If<match, typename next::rest,
+            typename Prepend<H, typename next::rest>::type>::type rest;
+};
+
+template <class A, class B> struct Concat;
+template <class... A, class... B> struct Concat<List<A...>, List<B...> > {
+    typedef List<A..., B...> type;
+};
+
+/*
+ * The port of the first pin of L, other than PORT, with K pins more than
+ * a multiple of 4 in L, i.e. the pins that would otherwise be left over.
+ */
+template <class PORT, class L, uint8_t K, class ALL = L> struct Partner {
+    static const bool found = false;
+    typedef void port;
+};
+template <class PORT, class H, class... T, uint8_t K, class ALL>
+struct Partner<PORT, List<H, T...>, K, ALL> {
+    typedef Partner<PORT, List<T...>, K, ALL> next;
+    static const bool match = !Same<PORT, typename H::port>::value &&
+        Count<typename H::port, ALL>::value % 4 == K;
+    static const bool found = match || next::found;
+    typedef typename If<match, typename H::port,
+            typename next::port>::type port;
+};
+
+#ifndef __AVR__
+/* Record the frame the routine would output. */
+template <class... I> void host_out(const RGB_t *const *rgb, uint16_t len,
+        uint16_t setup) {
+    WS2811_host_frame_t f;
+    f.nstrips = 0;
+    int strips[] = { (WS2811_host_strip(&f, I::port::name(), I::bit,
+            rgb[I::index], WS2811_PIXEL_BYTES), 0)... };
+    (void) strips;
+    WS2811_host_emit(&f, len, setup);
+}
+#endif
+
+/* One routine call outputting the pins of L. */
+template <class L> struct Kernel;
+template <class A> struct Kernel<List<A> > {
+    __attribute__((noinline)) static void out(const RGB_t *const *rgb,
+            uint16_t len) {
+#ifdef __AVR__
+        WS2811_OUT_1(_SFR_IO8(A::port::io), A::bit, rgb[A::index], len);
+#else
+        host_out<A>(rgb, len,
+                F_CPU < 16000000 ? 20 : WS2811_HOST_SETUP(18, 21));
+#endif
+    }
+};
+template <class A, class B> struct Kernel<List<A, B> > {
+    __attribute__((noinline)) static void out(const RGB_t *const *rgb,
+            uint16_t len) {
+#ifdef __AVR__
+        if (Same<typename A::port, typename B::port>::value)
+            WS2811_OUT_2_COMMON(_SFR_IO8(A::port::io), A::bit, rgb[A::index],
+                    B::bit, rgb[B::index], len);
+        else
+            WS2811_OUT_2(_SFR_IO8(A::port::io), A::bit, rgb[A::index],
+                    _SFR_IO8(B::port::io), B::bit, rgb[B::index], len);
+#else
+        host_out<A, B>(rgb, len,
+                Same<typename A::port, typename B::port>::value ?
+                WS2811_HOST_SETUP(35, 38) : WS2811_HOST_SETUP(34, 38));
+#endif
+    }
+};
+template <class A, class B, class C> struct Kernel<List<A, B, C> > {
+    __attribute__((noinline)) static void out(const RGB_t *const *rgb,
+            uint16_t len) {
+#ifdef __AVR__
+        WS2811_OUT_3_COMMON(_SFR_IO8(A::port::io), A::bit, rgb[A::index],
+                B::bit, rgb[B::index], C::bit, rgb[C::index], len);
+#else
+        host_out<A, B, C>(rgb, len, WS2811_HOST_SETUP(37, 40));
+#endif
+    }
+};
+template <class A, class B, class C, class D>
+struct Kernel<List<A, B, C, D> > {
+    static const bool common = Same<typename A::port, typename D::port>::value;
+    static const bool two = !Same<typename B::port, typename C::port>::value;
+
+    __attribute__((noinline)) static void out(const RGB_t *const *rgb,
+            uint16_t len) {
+#ifdef __AVR__
+        if (common)
+            WS2811_OUT_4_COMMON(_SFR_IO8(A::port::io), A::bit, rgb[A::index],
+                    B::bit, rgb[B::index], C::bit, rgb[C::index],
+                    D::bit, rgb[D::index], len);
+#if WS2811_PIXEL_BYTES == 3
+        else if (two)
+            WS2811_OUT_2_2(_SFR_IO8(A::port::io), A::bit, rgb[A::index],
+                    B::bit, rgb[B::index], _SFR_IO8(C::port::io),
+                    C::bit, rgb[C::index], D::bit, rgb[D::index], len);
+        else
+            WS2811_OUT_3_1(_SFR_IO8(A::port::io), A::bit, rgb[A::index],
+                    B::bit, rgb[B::index], C::bit, rgb[C::index],
+                    _SFR_IO8(D::port::io), D::bit, rgb[D::index], len);
+#endif
+#else
+        host_out<A, B, C, D>(rgb, len,
+                common ? WS2811_HOST_SETUP(39, 42) : 35);
+#endif
+    }
+};
+
+/*
+ * The routine for the first pin of L: a _COMMON one for up to 4 pins of
+ * its port, completed with the pins left over on another port through
+ * WS2811_OUT_2_2 or WS2811_OUT_3_1 where they add up to 4, or
+ * WS2811_OUT_2 pairing two single pins, or WS2811_OUT_1.
+ */
+template <class L> struct Plan {
+    static const uint8_t kernels = 0;
+    static void out(const RGB_t *const *, uint16_t) {}
+};
+template <class H, class... T> struct Plan<List<H, T...> > {
+    typedef List<H, T...> all;
+    typedef typename H::port port;
+    static const bool fast = F_CPU >= 16000000;
+    static const uint8_t n = fast ? Count<port, all>::value : 1;
+    typedef Take<port, n < 4 ? n : 4, all> group;
+    typedef Partner<port, all, fast && n < 4 ? 4 - n : 0> fill;
+    typedef Partner<port, all, 1> single;
+    static const bool mixed = fast && WS2811_PIXEL_BYTES == 3 && n < 4 &&
+            fill::found;
+    static const bool paired = fast && n == 1 && !mixed && single::found;
+    typedef Take<typename If<mixed, typename fill::port,
+            typename single::port>::type, mixed ? 4 - n : paired,
+            typename group::rest> other;
+    /* WS2811_OUT_3_1 takes the 3 pins first */
+    typedef typename If<mixed && n == 1,
+            typename Concat<typename other::taken,
+                    typename group::taken>::type,
+            typename Concat<typename group::taken,
+                    typename other::taken>::type>::type pins;
+    typedef Plan<typename other::rest> next;
+
+    static const uint8_t kernels = 1 + next::kernels;
+    static void out(const RGB_t *const *rgb, uint16_t len) {
+        Kernel<pins>::out(rgb, len);
+        next::out(rgb, len);
+    }
+};
+
+}
+
+template <class... PINS> struct Ws2811Bus {
+    typedef ws2811_detail::Plan<
+            typename ws2811_detail::Number<0, PINS...>::type> plan;
+
+    static const uint8_t kernels = plan::kernels;
+    static const uint16_t pixel_us = kernels * 10 * WS2811_PIXEL_BYTES;
+
+    static void out(const RGB_t *const *rgb, uint16_t len) {
+        plan::out(rgb, len);
+    }
+};
+#endif
+
 #endif /* WS2811_h */
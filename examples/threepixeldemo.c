@@ -6,8 +6,15 @@
  * Compile in GNU C99 mode (-std=gnu99)
  */
 
+#ifdef __AVR__
 #include <avr/io.h>
 #include <util/delay.h>
+#else
+// Host build, the frames go to $WS2811_DUMP (see WS2811.h).
+#include <stdint.h>
+static uint8_t PORTB, DDRB;
+#define _delay_ms(MS)
+#endif
 #include <WS2811.h>
 
 // Adjust as necessary.
@@ -15,7 +22,7 @@
 #define DDR    DDRB
 #define PIN       0
 #define PAUSE  1000     // msec
-#define DELAY    10	// msec
+#define FPS     100     // frames per second
 
 // Bit twiddling macros.
 #define BIT(B)           (0x01 << (uint8_t)(B))
@@ -25,6 +32,9 @@
 // Define the output function.
 DEFINE_WS2811_OUT_1_FN(WS2811RGB, PORT, PIN)
 
+// Paces the frames, see sched.max_cycles, sched.missed and sched.fps.
+static WS2811_sched_t sched;
+
 // Drive the three pixels in an infinite loop.
 void threepixeldemo(void)
 {
@@ -36,12 +46,12 @@ void threepixeldemo(void)
     RGB_t rgb[3] = {{0,0,0},{0,0,0},{0,0,0}};
     WS2811RGB(rgb, ARRAYLEN(rgb));
     _delay_ms(PAUSE);
+    WS2811_sched_init(&sched, FPS);
     for (int i = 0; i < 255; i++) {
         rgb[0].r += 1; 
         rgb[1].g += 1; 
         rgb[2].b += 1; 
-        WS2811RGB(rgb, ARRAYLEN(rgb));
-        _delay_ms(DELAY);
+        WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
     }
 
     // loop forever.
@@ -51,16 +61,14 @@ void threepixeldemo(void)
             rgb[0].g += 1; 
             rgb[1].b += 1; 
             rgb[2].r += 1; 
-            WS2811RGB(rgb, ARRAYLEN(rgb));
-            _delay_ms(DELAY);
+            WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
         }
         // yellow->green, cyan->blue, magenta->white
         for (int i = 0; i < 255; i++) {
             rgb[0].r -= 1; 
             rgb[1].g -= 1; 
             rgb[2].g += 1; 
-            WS2811RGB(rgb, ARRAYLEN(rgb));
-            _delay_ms(DELAY);
+            WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
         }
         // green->cyan, blue->magenta, white->red
         for (int i = 0; i < 255; i++) {
@@ -68,16 +76,14 @@ void threepixeldemo(void)
             rgb[1].r += 1; 
             rgb[2].g -= 1; 
             rgb[2].b -= 1; 
-            WS2811RGB(rgb, ARRAYLEN(rgb));
-            _delay_ms(DELAY);
+            WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
         }
         // cyan->blue, magenta->white, red->yellow
         for (int i = 0; i < 255; i++) {
             rgb[0].g -= 1;
             rgb[1].g += 1;
             rgb[2].g += 1;
-            WS2811RGB(rgb, ARRAYLEN(rgb));
-            _delay_ms(DELAY);
+            WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
         }
         // blue->magenta, white->red, yellow->green
         for (int i = 0; i < 255; i++) {
@@ -85,16 +91,14 @@ void threepixeldemo(void)
             rgb[1].g -= 1;
             rgb[1].b -= 1;
             rgb[2].r -= 1;
-            WS2811RGB(rgb, ARRAYLEN(rgb));
-            _delay_ms(DELAY);
+            WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
         }
         // magenta->white, red->yellow, green->cyan
         for (int i = 0; i < 255; i++) {
             rgb[0].g += 1;
             rgb[1].g += 1;
             rgb[2].b += 1;
-            WS2811RGB(rgb, ARRAYLEN(rgb));
-            _delay_ms(DELAY);
+            WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
         }
         // white->red, yellow->green, cyan->blue
         for (int i = 0; i < 255; i++) {
@@ -102,8 +106,7 @@ void threepixeldemo(void)
             rgb[0].g -= 1;
             rgb[1].r -= 1;
             rgb[2].g -= 1;
-            WS2811RGB(rgb, ARRAYLEN(rgb));
-            _delay_ms(DELAY);
+            WS2811_SCHED(&sched, WS2811RGB(rgb, ARRAYLEN(rgb)));
         }
     }
 }
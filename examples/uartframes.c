@@ -0,0 +1,113 @@
+/*
+ * Show frames received over the serial port on one strip, receiving the
+ * next frame while the current one is output (see WS2811_rx_t).
+ * The sender sends frames of LEN * 3 bytes in G, R, B order, one frame
+ * for every '+' received back, and after a gap of more than IDLE_MS
+ * within a frame waits for new '+'s.  Written for the atmega328p's USART0.
+ * Compile in GNU C99 mode (-std=gnu99)
+ */
+
+#ifdef __AVR__
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#else
+// Host build: frames are read from stdin, the output goes to $WS2811_DUMP.
+#include <stdint.h>
+#include <stdio.h>
+static uint8_t PORTB, DDRB;
+#define _delay_ms(MS)
+#endif
+#include <WS2811.h>
+
+// Adjust as necessary.
+#define PORT    PORTB
+#define DDR      DDRB
+#define PIN         0
+#define LEN       100
+#define BAUD   115200
+#define IDLE_MS    20
+
+// Reenable interrupts every 2 pixels (60us), so that the receive
+// interrupt takes each byte (86.8us at 115200 baud) in time.
+DEFINE_WS2811_OUT_1_WINDOW_FN(WS2811RGB, PORT, PIN, 2)
+
+static RGB_t buf[2 * LEN];
+static WS2811_rx_t rx;
+
+#ifdef __AVR__
+WS2811_RX_ISR(USART_RX_vect, rx, 0)
+
+// From the main loop only, the receive interrupt has to stay short.
+static void credit(uint8_t n)
+{
+    while (n--) {
+        loop_until_bit_is_set(UCSR0A, UDRE0);
+        UDR0 = '+';
+    }
+}
+
+static void uart_init(void)
+{
+    UBRR0 = (F_CPU / 8 / BAUD) - 1;
+    UCSR0A = _BV(U2X0);
+    UCSR0B = _BV(RXCIE0) | _BV(RXEN0) | _BV(TXEN0);
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+}
+#else
+static void credit(uint8_t n)
+{
+    while (n--)
+        fputc('+', stderr);
+}
+
+// Feed one byte of stdin to the receiver as the interrupt would.
+static int uart_poll(void)
+{
+    int c = getchar();
+
+    if (c != EOF)
+        WS2811_rx_byte(&rx, c);
+    return c != EOF;
+}
+#endif
+
+int main(void)
+{
+    RGB_t *rgb;
+    uint8_t *seen = 0;
+    uint8_t idle = 0;
+
+    // Configure pin for output.
+    DDR |= 1 << PIN;
+    PORT &= ~(1 << PIN);
+
+#ifdef __AVR__
+    uart_init();
+    sei();
+#endif
+    credit(WS2811_rx_init(&rx, buf, LEN));
+
+    for (;;) {
+#ifndef __AVR__
+        if (!uart_poll() && !WS2811_rx_frame(&rx))
+            return 0;
+#endif
+        if ((rgb = WS2811_rx_frame(&rx))) {
+            WS2811RGB(rgb, LEN);
+            WS2811_rx_done(&rx);
+            credit(1);
+            idle = 0;
+        } else if (WS2811_rx_ptr(&rx) != seen) {
+            seen = WS2811_rx_ptr(&rx);
+            idle = 0;
+        } else if (idle < IDLE_MS) {
+            _delay_ms(1);
+            idle++;
+        } else {
+            // A byte was lost or the sender stopped mid-frame.
+            credit(WS2811_rx_sync(&rx));
+            idle = 0;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Build test of the C++ interface.
+ *
+ * Declares Ws2811Bus instances covering every routine they choose from,
+ * checks the number of routine calls with static_assert() and outputs
+ * through each of them, so that building it for the AVR compiles the
+ * routines with the Ws2811Port types' I/O addresses as their "I" operands.
+ * See the Makefile.  Also builds for the host, where the ports are the
+ * variables below and the frames go to $WS2811_DUMP.
+ * Compile in GNU C++11 mode (-std=gnu++11)
+ */
+
+#ifdef __AVR__
+#include <avr/io.h>
+#else
+#include <stdint.h>
+static uint8_t PORTB, PORTC, PORTD;
+#define PORTB PORTB
+#define PORTC PORTC
+#define PORTD PORTD
+#endif
+#include <WS2811.h>
+
+typedef Ws2811Pin<Ws2811PortB, 0> B0;
+typedef Ws2811Pin<Ws2811PortB, 4> B4;
+typedef Ws2811Pin<Ws2811PortB, 5> B5;
+typedef Ws2811Pin<Ws2811PortC, 0> C0;
+typedef Ws2811Pin<Ws2811PortC, 1> C1;
+typedef Ws2811Pin<Ws2811PortC, 2> C2;
+typedef Ws2811Pin<Ws2811PortC, 3> C3;
+typedef Ws2811Pin<Ws2811PortC, 5> C5;
+typedef Ws2811Pin<Ws2811PortD, 6> D6;
+typedef Ws2811Pin<Ws2811PortD, 7> D7;
+
+// WS2811_OUT_1.
+typedef Ws2811Bus<B0> Bus1;
+// WS2811_OUT_2_COMMON and WS2811_OUT_1.
+typedef Ws2811Bus<C0, C1, B4> Bus3;
+// WS2811_OUT_2.
+typedef Ws2811Bus<B0, D7> Bus2;
+// WS2811_OUT_2_2 and WS2811_OUT_3_1.
+typedef Ws2811Bus<C0, C1, B4, B5> Bus22;
+typedef Ws2811Bus<B4, C0, C1, C5> Bus31;
+// WS2811_OUT_4_COMMON, WS2811_OUT_2_COMMON and WS2811_OUT_2.
+typedef Ws2811Bus<B0, C0, C1, C2, C3, C5, D7, D6> Bus8;
+
+#if F_CPU >= 16000000 && WS2811_PIXEL_BYTES == 3
+static_assert(Bus1::kernels == 1 && Bus3::kernels == 2 &&
+        Bus2::kernels == 1 && Bus22::kernels == 1 && Bus31::kernels == 1 &&
+        Bus8::kernels == 3, "routine calls");
+static_assert(Bus3::pixel_us == 60, "time per pixel");
+#elif F_CPU < 16000000
+static_assert(Bus1::kernels == 1 && Bus3::kernels == 3 &&
+        Bus2::kernels == 2 && Bus22::kernels == 4 && Bus31::kernels == 4 &&
+        Bus8::kernels == 8, "routine calls");
+#endif
+
+#define LEN 4
+
+static RGB_t strips[8][LEN];
+
+int main(void) {
+    const RGB_t *rgb[8];
+    uint8_t i;
+
+#ifdef __AVR__
+    DDRB = DDRC = DDRD = 0xff;
+#else
+    PORTB = PORTC = PORTD = 0;
+#endif
+    for (i = 0; i < 8; i++)
+        rgb[i] = strips[i];
+    Bus1::out(rgb, LEN);
+    Bus3::out(rgb, LEN);
+    Bus2::out(rgb, LEN);
+    Bus22::out(rgb, LEN);
+    Bus31::out(rgb, LEN);
+    Bus8::out(rgb, LEN);
+    return 0;
+}
@@ -0,0 +1,362 @@
+/*
+ * Timing test and benchmark of the output routines.
+ *
+ * Calls every routine available at F_CPU with pseudo-random pixels for
+ * a few lengths, and two _LENS_FN functions chaining them for strips of
+ * different lengths, setting GPIOR0 to 1 around each call.  Built for the
+ * AVR it runs under simavr, which traces PORTB, PORTC, PORTD, GPIOR0 and
+ * UDR0 to VCD_FILE.  Built for the host it runs the same calls through the
+ * host versions of the routines, which dump the expected frames to
+ * $WS2811_DUMP, and prints the name of the routine of every frame.
+ * ws2811check then decodes the VCD against both.  See the Makefile.
+ * Compile in GNU C99 mode (-std=gnu99)
+ */
+
+#ifdef __AVR__
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include "avr_mcu_section.h"
+#else
+#include <stdint.h>
+#include <stdio.h>
+static uint8_t PORTB, PORTC, PORTD;
+#endif
+#include <WS2811.h>
+
+#ifdef __AVR__
+AVR_MCU(F_CPU, "atmega328p");
+AVR_MCU_VCD_FILE(VCD_FILE, 1000);
+
+const struct avr_mmcu_vcd_trace_t trace[] _MMCU_ = {
+    { AVR_MCU_VCD_SYMBOL("PORTB"), .what = (void *) &PORTB, },
+    { AVR_MCU_VCD_SYMBOL("PORTC"), .what = (void *) &PORTC, },
+    { AVR_MCU_VCD_SYMBOL("PORTD"), .what = (void *) &PORTD, },
+    { AVR_MCU_VCD_SYMBOL("GPIOR0"), .what = (void *) &GPIOR0, },
+    { AVR_MCU_VCD_SYMBOL("UDR0"), .what = (void *) &UDR0, },
+};
+
+// GPIOR0 is 1 during a frame, 2 for the one cycle of the markers alone.
+#define BEGIN(NAME) (GPIOR0 = 1)
+#define END() (GPIOR0 = 0)
+#define CALIBRATE() (GPIOR0 = 2, GPIOR0 = 0)
+#else
+static const char *variant = "";
+
+// The frame about to be dumped is the routine's.
+#define BEGIN(NAME) printf("%lu %s%s\n", \
+        (unsigned long) WS2811_host_frames, NAME, variant)
+#define END() ((void) 0)
+#define CALIBRATE() printf("F_CPU %lu\n", (unsigned long) F_CPU)
+#define sei()
+#define cli()
+#endif
+
+#define MAXLEN 10
+static const uint16_t lens[] = { 0, 1, 2, MAXLEN };
+
+// Pins no strip is on, held high to check that they aren't touched.
+#define SPAREB 0x08
+#define SPAREC 0x20
+#define SPARED 0x40
+
+// A function per call so the markers are around little more than the asm.
+#define TEST_FN(FN, ROUTINE, ARGS, ...) \
+static void __attribute__((noinline)) FN ARGS { \
+    BEGIN(#ROUTINE); \
+    ROUTINE(__VA_ARGS__); \
+    END(); \
+}
+
+static uint8_t buf[2 * MAXLEN * 8 * sizeof(RGB_t)];
+#define STREAM(N) ((RGB_t *) (buf + (N) * MAXLEN * sizeof(RGB_t)))
+
+static uint16_t seed = 1;
+
+static void fill(uint8_t *p, uint16_t n) {
+    while (n--) {
+        seed = (uint16_t) (seed * 25173u + 13849u);
+        *p++ = seed >> 8;
+    }
+}
+
+TEST_FN(out_1, WS2811_OUT_1, (const RGB_t *rgb, uint16_t len),
+        PORTB, 0, rgb, len)
+TEST_FN(out_8_packed, WS2811_OUT_8_PACKED, (uint8_t *data, uint16_t len),
+        PORTD, data, len)
+
+#if F_CPU >= 16000000
+// 1KB of pseudo-random flash data.
+#define H(I) (uint8_t) (((I) * 2654435761u) >> 24)
+#define H2(I) H(I), H((I) + 1)
+#define H4(I) H2(I), H2((I) + 2)
+#define H8(I) H4(I), H4((I) + 4)
+#define H16(I) H8(I), H8((I) + 8)
+#define H32(I) H16(I), H16((I) + 16)
+#define H64(I) H32(I), H32((I) + 32)
+#define H128(I) H64(I), H64((I) + 64)
+#define H256(I) H128(I), H128((I) + 128)
+#define H512(I) H256(I), H256((I) + 256)
+static const uint8_t flash[1024] PROGMEM = { H512(0), H512(512) };
+
+static const uint8_t lut[256] PROGMEM = { H256(1024) };
+
+TEST_FN(out_1_window, WS2811_OUT_1_WINDOW,
+        (const RGB_t *rgb, uint16_t len), PORTB, 1, rgb, len, 1)
+TEST_FN(out_1_scale, WS2811_OUT_1_SCALE, (const RGB_t *rgb, uint16_t len),
+        PORTB, 2, rgb, len, 100)
+TEST_FN(out_1_lut, WS2811_OUT_1_LUT, (const RGB_t *rgb, uint16_t len),
+        PORTB, 4, rgb, len, lut)
+TEST_FN(out_1_p, WS2811_OUT_1_P, (uint16_t len),
+        PORTC, 0, (const RGB_t *) flash, len)
+TEST_FN(out_2, WS2811_OUT_2,
+        (const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len),
+        PORTB, 0, rgb0, PORTD, 7, rgb1, len)
+TEST_FN(out_2_p, WS2811_OUT_2_P, (uint16_t len),
+        PORTB, 1, PORTC, 4, flash, len)
+TEST_FN(out_2_scale, WS2811_OUT_2_SCALE,
+        (const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len),
+        PORTB, 0, rgb0, PORTC, 1, rgb1, len, 200)
+TEST_FN(out_2_lut, WS2811_OUT_2_LUT,
+        (const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len),
+        PORTB, 5, rgb0, PORTD, 2, rgb1, len, lut)
+TEST_FN(out_2_common, WS2811_OUT_2_COMMON,
+        (const RGB_t *rgb0, const RGB_t *rgb1, uint16_t len),
+        PORTD, 0, rgb0, 5, rgb1, len)
+TEST_FN(out_3_common, WS2811_OUT_3_COMMON,
+        (const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2,
+         uint16_t len),
+        PORTD, 0, rgb0, 2, rgb1, 7, rgb2, len)
+TEST_FN(out_4_common, WS2811_OUT_4_COMMON,
+        (const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2,
+         const RGB_t *rgb3, uint16_t len),
+        PORTB, 0, rgb0, 1, rgb1, 4, rgb2, 7, rgb3, len)
+TEST_FN(out_4_common_p, WS2811_OUT_4_COMMON_P, (uint16_t len),
+        PORTC, 0, 1, 2, 4, flash, len)
+TEST_FN(out_4_mask, WS2811_OUT_4_MASK,
+        (const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2,
+         const RGB_t *rgb3, uint16_t len),
+        PORTB, 0x01, rgb0, 0x06, rgb1, 0x10, rgb2, 0x00, rgb3, len)
+TEST_FN(out_8_packed_p, WS2811_OUT_8_PACKED_P, (uint16_t len),
+        PORTB, flash, len)
+TEST_FN(out_16_packed, WS2811_OUT_16_PACKED,
+        (uint8_t *data0, uint8_t *data1, uint16_t len),
+        PORTB, data0, PORTD, data1, len)
+TEST_FN(out_16_packed_p, WS2811_OUT_16_PACKED_P, (uint16_t len),
+        PORTB, PORTD, flash, len)
+
+DEFINE_WS2811_OUT_2_LENS_FN(out_2_lens, PORTB, 0, PORTD, 7)
+DEFINE_WS2811_OUT_4_COMMON_LENS_FN(out_4_common_lens, PORTB, 0, 1, 4, 7)
+
+// Each chain of routines is one frame, checking the gaps between them.
+static void chains(uint16_t len) {
+#ifndef __AVR__
+    variant = "+lens";
+#endif
+    BEGIN("WS2811_OUT_2");
+    out_2_lens(STREAM(0), len / 2, STREAM(1), len);
+    END();
+    BEGIN("WS2811_OUT_4_COMMON");
+    out_4_common_lens(STREAM(2), len, STREAM(3), len - len / 4, STREAM(4),
+            len / 2, STREAM(5), len / 4);
+    END();
+#ifndef __AVR__
+    variant = "";
+#endif
+}
+
+#if WS2811_PIXEL_BYTES == 3
+static uint8_t idx[MAXLEN];
+#define C(R, G, B) { .r = (R), .g = (G), .b = (B) }
+static const RGB_t pal[16] = {
+    C(0, 0, 0), C(255, 255, 255), C(255, 0, 0), C(0, 255, 0),
+    C(0, 0, 255), C(1, 2, 3), C(128, 64, 32), C(85, 170, 85),
+    C(0x0f, 0xf0, 0x5a), C(0xa5, 0xc3, 0x3c), C(254, 127, 1),
+    C(7, 77, 177), C(200, 100, 50), C(17, 34, 68), C(136, 1, 16),
+    C(99, 0, 99),
+};
+
+// Runs of 1, 3, 1, 5 and 256 pixels: MAXLEN ends with the 4th one.
+static const uint8_t rle[] PROGMEM = {
+    0, 0x12, 0x34, 0x56, 2, 0xff, 0x00, 0x81, 0, 0xa5, 0x5a, 0x0f,
+    4, 0x01, 0x80, 0xfe, 255, 0x33, 0xcc, 0x69,
+};
+
+TEST_FN(out_1_pal8, WS2811_OUT_1_PAL8, (const uint8_t *idx, uint16_t len),
+        PORTB, 6, idx, len, pal)
+TEST_FN(out_1_pal4, WS2811_OUT_1_PAL4, (const uint8_t *idx, uint16_t len),
+        PORTB, 7, idx, len, pal)
+TEST_FN(out_1_rle, WS2811_OUT_1_RLE, (uint16_t len), PORTC, 1, rle, len)
+TEST_FN(out_1_fill, WS2811_OUT_1_FILL, (RGB_t rgb, uint16_t len),
+        PORTC, 2, rgb, len)
+TEST_FN(out_1_gradient, WS2811_OUT_1_GRADIENT,
+        (RGB_t from, RGB_t to, uint16_t len), PORTC, 3, from, to, len)
+TEST_FN(out_2_2, WS2811_OUT_2_2,
+        (const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2,
+         const RGB_t *rgb3, uint16_t len),
+        PORTB, 0, rgb0, 1, rgb1, PORTC, 2, rgb2, 3, rgb3, len)
+TEST_FN(out_3_1, WS2811_OUT_3_1,
+        (const RGB_t *rgb0, const RGB_t *rgb1, const RGB_t *rgb2,
+         const RGB_t *rgb3, uint16_t len),
+        PORTD, 0, rgb0, 1, rgb1, 2, rgb2, PORTB, 7, rgb3, len)
+TEST_FN(out_7_common, WS2811_OUT_7_COMMON, (const RGB_t *rgb, uint16_t len),
+        PORTB, 0, 1, 2, 4, 5, 6, 7, rgb, len)
+#if F_CPU == 20000000
+TEST_FN(out_8_common, WS2811_OUT_8_COMMON, (const RGB_t *rgb, uint16_t len),
+        PORTD, rgb, len)
+#endif
+#endif /* WS2811_PIXEL_BYTES == 3 */
+#endif /* F_CPU >= 16000000 */
+
+#if F_CPU == 16000000
+TEST_FN(out_1_usart, WS2811_OUT_1_USART, (const RGB_t *rgb, uint16_t len),
+        0, rgb, len)
+#endif
+
+static void idle(void) {
+    PORTB = SPAREB;
+    PORTC = SPAREC;
+    PORTD = SPARED;
+}
+
+// In the order of the table in README.md.
+static void test(uint16_t len) {
+    fill(buf, sizeof(buf));
+    idle();
+    out_1(STREAM(0), len);
+#if F_CPU >= 16000000
+    out_2(STREAM(0), STREAM(1), len);
+    out_1_window(STREAM(1), len);
+    out_1_scale(STREAM(2), len);
+    out_1_lut(STREAM(3), len);
+    out_2_scale(STREAM(2), STREAM(3), len);
+    out_2_lut(STREAM(4), STREAM(5), len);
+#if WS2811_PIXEL_BYTES == 3
+    {
+        uint8_t i;
+
+        for (i = 0; i < MAXLEN; i++)
+            idx[i] = buf[i] & 15;
+    }
+    out_1_pal8(idx, len);
+    out_1_pal4(buf, len);
+#endif
+    out_1_p(len);
+#if WS2811_PIXEL_BYTES == 3
+    out_1_rle(len);
+    out_1_fill(*STREAM(0), len);
+    out_1_gradient(*STREAM(1), *STREAM(2), len);
+#endif
+    out_2_p(len);
+    out_2_common(STREAM(6), STREAM(7), len);
+    out_3_common(STREAM(0), STREAM(2), STREAM(4), len);
+    out_4_common(STREAM(1), STREAM(3), STREAM(5), STREAM(7), len);
+    out_4_common_p(len);
+    out_4_mask(STREAM(8), STREAM(9), STREAM(10), STREAM(11), len);
+    chains(len);
+#if WS2811_PIXEL_BYTES == 3
+    out_2_2(STREAM(0), STREAM(1), STREAM(2), STREAM(3), len);
+    out_3_1(STREAM(4), STREAM(5), STREAM(6), STREAM(7), len);
+    out_7_common(STREAM(0), len);
+#if F_CPU == 20000000
+    PORTD = 0;
+    out_8_common(STREAM(0), len);
+#endif
+#endif /* WS2811_PIXEL_BYTES == 3 */
+#endif /* F_CPU >= 16000000 */
+    PORTD = 0;
+    out_8_packed(buf, len);
+#if F_CPU >= 16000000
+    PORTB = 0;
+    out_8_packed_p(len);
+    out_16_packed(buf, buf + MAXLEN * 8 * WS2811_PIXEL_BYTES, len);
+    out_16_packed_p(len);
+#endif
+    idle();
+#if F_CPU == 16000000
+    out_1_usart(STREAM(0), len);
+#endif
+}
+
+#if F_CPU >= 16000000
+#ifdef __AVR__
+ISR(TIMER0_COMPA_vect) {
+    GPIOR1++;
+}
+
+// A short interrupt every 20us, taken between pixels by WS2811_OUT_1_WINDOW.
+static void irq_on(void) {
+    OCR0A = F_CPU / 8 / 50000 - 1;
+    TCNT0 = 0;
+    TCCR0A = _BV(WGM01);
+    TCCR0B = _BV(CS01);
+    TIMSK0 = _BV(OCIE0A);
+    sei();
+}
+
+static void irq_off(void) {
+    cli();
+    TIMSK0 = 0;
+    TCCR0B = 0;
+}
+#else
+#define irq_on() (variant = "+irq")
+#define irq_off() (variant = "")
+#endif
+
+// Frames received a byte at a time between the outputs of the last ones.
+static void test_rx(void) {
+    WS2811_rx_t rx;
+    RGB_t *rgb;
+    uint8_t data[3 * 4 * sizeof(RGB_t)];
+    uint16_t i;
+
+    fill(data, sizeof(data));
+    WS2811_rx_init(&rx, STREAM(0), 4);
+#ifndef __AVR__
+    variant = "+rx";
+#endif
+    for (i = 0; i < sizeof(data); i++) {
+        WS2811_IRQ_SAVE(sreg);
+        WS2811_rx_byte(&rx, data[i]);
+        WS2811_IRQ_RESTORE(sreg);
+        if ((rgb = WS2811_rx_frame(&rx))) {
+            out_1_window(rgb, rx.len);
+            WS2811_rx_done(&rx);
+        }
+    }
+#ifndef __AVR__
+    variant = "";
+#endif
+}
+#endif /* F_CPU >= 16000000 */
+
+int main(void) {
+    uint8_t i;
+
+#ifdef __AVR__
+    DDRB = DDRC = DDRD = 0xff;
+#if F_CPU == 16000000
+    WS2811_USART_INIT(0);
+#endif
+#endif
+    CALIBRATE();
+    for (i = 0; i < ARRAYLEN(lens); i++)
+        test(lens[i]);
+#if F_CPU >= 16000000
+    fill(buf, sizeof(buf));
+    idle();
+    irq_on();
+    for (i = 0; i < ARRAYLEN(lens); i++)
+        out_1_window(STREAM(i), lens[i]);
+    irq_off();
+    test_rx();
+#endif
+#ifdef __AVR__
+    // simavr stops on sleep with interrupts disabled.
+    cli();
+    sleep_mode();
+#endif
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * Check examples/uartframes.c receiving frames while it outputs them.
+ *
+ * Runs the example built for the atmega328p at 16MHz (uartframes.elf, see
+ * the Makefile) under libsimavr and acts as the sender: NFRAMES frames
+ * of pseudo-random pixels sent at BAUD, one frame for every '+' read
+ * back.  Frame ABORT is cut short halfway, after which the sender waits
+ * for the 2 credits of the example's WS2811_rx_sync() and carries on.
+ * Checks that
+ * - the receive interrupt takes every byte before the byte 3 places
+ *   after it starts, when the hardware's 2-byte buffer would overrun
+ *   (simavr's UART itself never loses a byte),
+ * - PB0 carries the frames sent, bar the cut one, in order, with every
+ *   bit high for 250ns or 1000ns and every low period within a frame
+ *   no longer than WS2811_MAX_GAP_US.
+ * Exits with 1 if any check failed.
+ * Build natively: gcc -std=gnu99 -I.. -I/usr/include/simavr uart.c \
+ *     -o uart -lsimavr -lelf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_irq.h"
+#include "sim_interrupts.h"
+#include "sim_cycle_timers.h"
+#include "avr_ioport.h"
+#include "avr_uart.h"
+
+#define F_CPU 16000000UL
+#include <WS2811.h>
+
+/* As in examples/uartframes.c. */
+#define LEN 100
+#define BAUD 115200
+#define IDLE_MS 20
+
+#define USART_RX_VECTOR 18
+#define FRAME_BYTES (LEN * WS2811_PIXEL_BYTES)
+#define NFRAMES 8
+#define ABORT 4
+#define RESET_CYCLES (F_CPU / 1000000 * 50)
+#define GAP_CYCLES (F_CPU / 1000000 * WS2811_MAX_GAP_US)
+
+typedef struct {
+    uint64_t cycle;
+    uint8_t value;
+} edge_t;
+
+static avr_t *avr;
+static avr_irq_t *uart_in;
+static unsigned credits;            /* '+'s not used yet */
+static unsigned frame;              /* being sent */
+static unsigned pos;                /* next byte of it */
+static int waiting;                 /* for the resync credits */
+static int done;
+static uint64_t sent[(NFRAMES + 1) * FRAME_BYTES];
+static unsigned nsent, nread;
+static edge_t *edges;
+static size_t nedges;
+static unsigned errors;
+
+/* The bytes of frame F, the same on both sides. */
+static uint8_t frame_byte(unsigned f, unsigned i) {
+    return (uint8_t) ((f * 2654435761u + i * 40503u) >> 9);
+}
+
+/* Cycles of N bytes at BAUD. */
+static avr_cycle_count_t byte_start(unsigned n) {
+    return (avr_cycle_count_t) n * 10 * F_CPU / BAUD;
+}
+
+static avr_cycle_count_t send(avr_t *a, avr_cycle_count_t when,
+        void *param) {
+    (void) a;
+    (void) param;
+    if (pos == 0) {
+        if (frame == NFRAMES) {
+            done = 1;
+            return 0;
+        }
+        /* Cut frame ABORT once all the frames before it are out. */
+        if (waiting || !credits || (frame == ABORT && credits < 2))
+            return when + byte_start(1);
+        credits--;
+    }
+    sent[nsent++] = when;
+    avr_raise_irq(uart_in, frame_byte(frame, pos));
+    if (++pos == (frame == ABORT ? FRAME_BYTES / 2 : FRAME_BYTES)) {
+        if (frame == ABORT) {
+            credits = 0;
+            waiting = 1;
+        }
+        frame++;
+        pos = 0;
+    }
+    return when + byte_start(1);
+}
+
+static void uart_out(avr_irq_t *irq, uint32_t value, void *param) {
+    (void) irq;
+    (void) param;
+    if (value != '+')
+        return;
+    credits++;
+    if (waiting && credits == 2)
+        waiting = 0;
+}
+
+static void rx_running(avr_irq_t *irq, uint32_t value, void *param) {
+    (void) irq;
+    (void) param;
+    if (!value)
+        return;
+    if (nread >= nsent) {
+        fprintf(stderr, "interrupt %u without a byte\n", nread);
+        errors++;
+    } else if (avr->cycle >= sent[nread] + byte_start(3)) {
+        fprintf(stderr, "byte %u taken %lu cycles after its start\n",
+                nread, (unsigned long) (avr->cycle - sent[nread]));
+        errors++;
+    }
+    nread++;
+}
+
+static void pin_change(avr_irq_t *irq, uint32_t value, void *param) {
+    (void) irq;
+    (void) param;
+    if (nedges && edges[nedges - 1].value == !!value)
+        return;
+    if (!(nedges & 1023)) {
+        edges = realloc(edges, (nedges + 1024) * sizeof(edge_t));
+        if (!edges) {
+            perror("realloc");
+            exit(2);
+        }
+    }
+    edges[nedges].cycle = avr->cycle;
+    edges[nedges++].value = !!value;
+}
+
+/* Decode the frames on PB0 and compare them with the ones sent. */
+static void check(void) {
+    unsigned f = 0, nframes = 0, n = 0;
+    uint8_t byte = 0;
+    size_t i;
+
+    for (i = 0; i + 1 < nedges; i++) {
+        uint64_t width = edges[i + 1].cycle - edges[i].cycle;
+
+        if (!edges[i].value) {
+            if (width > RESET_CYCLES || i == 0) {
+                if (n) {
+                    fprintf(stderr, "frame %u: %u bits\n", f, n);
+                    errors++;
+                }
+                if (i) {
+                    nframes++;
+                    f++;
+                }
+                if (f == ABORT)
+                    f++;
+                n = 0;
+            } else if (width > GAP_CYCLES) {
+                fprintf(stderr, "frame %u bit %u: %lu cycles low\n", f, n,
+                        (unsigned long) width);
+                errors++;
+            }
+            continue;
+        }
+        if (width != F_CPU / 4000000 && width != F_CPU / 1000000) {
+            fprintf(stderr, "frame %u bit %u: %lu cycles high\n", f, n,
+                    (unsigned long) width);
+            errors++;
+        }
+        byte = byte << 1 | (width == F_CPU / 1000000);
+        if (++n % 8)
+            continue;
+        if (byte != frame_byte(f, n / 8 - 1)) {
+            fprintf(stderr, "frame %u byte %u: %02x\n", f, n / 8 - 1,
+                    byte);
+            errors++;
+        }
+        if (n == FRAME_BYTES * 8)
+            n = 0;
+    }
+    if (nedges)
+        nframes++;
+    if (nframes != NFRAMES - 1 || f != NFRAMES - 1) {
+        fprintf(stderr, "%u frames out, ending with %u\n", nframes, f);
+        errors++;
+    }
+}
+
+int main(int argc, char **argv) {
+    elf_firmware_t fw;
+    uint32_t flags = 0;
+    avr_cycle_count_t limit;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s uartframes.elf\n", argv[0]);
+        return 2;
+    }
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(argv[1], &fw)) {
+        fprintf(stderr, "%s: can't load\n", argv[1]);
+        return 2;
+    }
+    avr = avr_make_mcu_by_name("atmega328p");
+    if (!avr)
+        return 2;
+    avr_init(avr);
+    avr->frequency = F_CPU;
+    avr_load_firmware(avr, &fw);
+
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    uart_in = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'),
+            UART_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'),
+            UART_IRQ_OUTPUT), uart_out, NULL);
+    avr_irq_register_notify(avr_get_interrupt_irq(avr, USART_RX_VECTOR) +
+            AVR_INT_IRQ_RUNNING, rx_running, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'),
+            0), pin_change, NULL);
+    avr_cycle_timer_register(avr, byte_start(1), send, NULL);
+
+    /* Every frame's transfer and output, the resync, and some slack. */
+    limit = byte_start(NFRAMES * FRAME_BYTES) + (IDLE_MS + 30) * F_CPU / 1000
+            + F_CPU / 10;
+    while (avr->cycle < limit) {
+        int state = avr_run(avr);
+
+        if (state == cpu_Done || state == cpu_Crashed) {
+            fprintf(stderr, "stopped at cycle %lu\n",
+                    (unsigned long) avr->cycle);
+            return 1;
+        }
+    }
+    if (!done) {
+        fprintf(stderr, "stalled at frame %u byte %u\n", frame, pos);
+        errors++;
+    }
+    check();
+    printf("%u frames, %u bytes, %u errors\n", NFRAMES, nsent, errors);
+    return errors != 0;
+}
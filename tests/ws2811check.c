@@ -0,0 +1,580 @@
+/*
+ * Check the output of tests/timing.c traced by simavr.
+ *
+ * For every BASE argument reads BASE.vcd, the pins traced by simavr, and
+ * BASE.names and BASE.frames, the routine names and the expected frames
+ * written by the host build.  The frames are the GPIOR0 = 1 intervals of
+ * the trace, in order.  Every strip's pin is decoded bit by bit and
+ * checked against the timing WS2811.h promises: a bit every 1.25us, high
+ * for 250ns for a 0 and for 1000ns for a 1, longer low periods only
+ * between pixels and no longer than WS2811_MAX_GAP_US, the pin low
+ * before and after the call.  The decoded bits have to be the expected
+ * pixels and the pins without a strip must not change.  A routine name
+ * covers the host frames up to the next name's, so a chain of routines
+ * called between the markers, like the _LENS_FN functions, is checked
+ * as one frame with each pin's pixels joined, including the gaps
+ * between the routines.  The USART
+ * routine is only checked for the symbols written to UDR0, as simavr
+ * doesn't model the master SPI mode timing.
+ *
+ * Prints one line per frame with its duration and setup cycles (the
+ * cycles beyond the 1.25us per bit, less those of the GPIOR0 markers),
+ * or with -t the setup table of README.md, one column per BASE.  Exits
+ * with 1 if any check failed.
+ * Build natively: gcc -std=gnu99 -I.. ws2811check.c -o ws2811check
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <WS2811.h>
+
+#define MAXSIGNALS 8
+
+typedef struct {
+    uint64_t cycle;
+    uint8_t signal;
+    uint8_t value;
+} event_t;
+
+typedef struct {
+    char id[64];
+    char name[64];
+    uint8_t value;                  /* at the current event */
+} signal_t;
+
+typedef struct {
+    char port[16];
+    uint8_t pin;
+    uint16_t len;
+    uint8_t *grb;
+} strip_t;
+
+typedef struct {
+    char name[48];
+    unsigned long seq;              /* first host frame */
+    uint32_t cycles;                /* host model */
+    uint16_t len;                   /* of the longest strip */
+    uint8_t nstrips;
+    strip_t strip[16];
+} frame_t;
+
+typedef struct {
+    char name[48];
+    uint8_t strips;
+    long setup[8];                  /* per BASE, -1 if not measured */
+} row_t;
+
+static unsigned long f_cpu;
+static uint8_t pixel_bytes;
+static signal_t signals[MAXSIGNALS];
+static uint8_t nsignals;
+static event_t *events;
+static size_t nevents;
+static frame_t *frames;
+static size_t nframes;
+static row_t rows[64];
+static uint8_t nrows;
+static unsigned errors;
+
+static void *xrealloc(void *p, size_t size) {
+    if (!(p = realloc(p, size))) {
+        perror("realloc");
+        exit(2);
+    }
+    return p;
+}
+
+static FILE *open_file(const char *base, const char *ext) {
+    char path[1024];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s.%s", base, ext);
+    if (!(f = fopen(path, "r"))) {
+        perror(path);
+        exit(2);
+    }
+    return f;
+}
+
+static int find_signal(const char *name) {
+    uint8_t i;
+
+    for (i = 0; i < nsignals; i++)
+        if (strcmp(signals[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+/* The port's signal, USART<n> being traced as UDR<n>. */
+static int port_signal(const char *port) {
+    char name[64];
+
+    if (strncmp(port, "USART", 5) == 0) {
+        snprintf(name, sizeof(name), "UDR%s", port + 5);
+        return find_signal(name);
+    }
+    return find_signal(port);
+}
+
+/* Read the value changes, with the times converted to CPU cycles. */
+static void read_vcd(const char *base) {
+    FILE *f = open_file(base, "vcd");
+    char tok[256], id[64], name[64], unit[16];
+    double ps_per_tick = 1000, t;
+    uint64_t cycle = 0;
+    unsigned long val;
+    int i, n;
+
+    nsignals = 0;
+    nevents = 0;
+    while (fscanf(f, "%255s", tok) == 1) {
+        if (strcmp(tok, "$timescale") == 0) {
+            if (fscanf(f, "%255s", tok) != 1)
+                break;
+            n = 1;
+            unit[0] = 0;
+            if (sscanf(tok, "%d%15s", &n, unit) < 2 &&
+                    fscanf(f, "%15s", unit) != 1)
+                break;
+            ps_per_tick = n * (strcmp(unit, "s") == 0 ? 1e12 :
+                    strcmp(unit, "ms") == 0 ? 1e9 :
+                    strcmp(unit, "us") == 0 ? 1e6 :
+                    strcmp(unit, "ns") == 0 ? 1e3 : 1);
+        } else if (strcmp(tok, "$var") == 0) {
+            if (fscanf(f, "%*s %*s %63s %63s", id, name) != 2)
+                break;
+            if (nsignals == MAXSIGNALS)
+                continue;
+            snprintf(signals[nsignals].id, sizeof(signals[0].id), "%s", id);
+            snprintf(signals[nsignals].name, sizeof(signals[0].name), "%s",
+                    name);
+            signals[nsignals++].value = 0;
+        } else if (tok[0] == '$') {
+            if (strcmp(tok, "$end") != 0 &&
+                    strcmp(tok, "$dumpvars") != 0)
+                while (fscanf(f, "%255s", tok) == 1 &&
+                        strcmp(tok, "$end") != 0)
+                    ;
+        } else if (tok[0] == '#') {
+            t = strtod(tok + 1, NULL) * ps_per_tick;
+            cycle = (uint64_t) (t * (f_cpu / 1e12) + 0.5);
+        } else {
+            char *p = tok;
+
+            if (tok[0] == 'b' || tok[0] == 'B') {
+                if (fscanf(f, "%63s", id) != 1)
+                    break;
+                p = tok + 1;
+            } else {
+                snprintf(id, sizeof(id), "%.63s", tok + 1);
+                tok[1] = 0;
+            }
+            for (val = 0; *p; p++)
+                val = (val << 1) | (*p == '1');
+            for (i = 0; i < nsignals; i++)
+                if (strcmp(signals[i].id, id) == 0) {
+                    events = (event_t *) xrealloc(events,
+                            (nevents + 1) * sizeof(*events));
+                    events[nevents].cycle = cycle;
+                    events[nevents].signal = i;
+                    events[nevents++].value = (uint8_t) val;
+                }
+        }
+    }
+    fclose(f);
+}
+
+static uint8_t hex(const char *p) {
+    char s[3] = { p[0], p[1], 0 };
+
+    return (uint8_t) strtoul(s, NULL, 16);
+}
+
+/* Read the expected frames and their routines' names. */
+static void read_frames(const char *base) {
+    FILE *f = open_file(base, "names");
+    char line[4096], *tok, *save;
+    unsigned long seq, last = (unsigned long) -1;
+    size_t i, k = 0;
+    uint8_t j, pin;
+
+    f_cpu = 0;
+    nframes = 0;
+    if (!fgets(line, sizeof(line), f) ||
+            sscanf(line, "F_CPU %lu", &f_cpu) != 1) {
+        fprintf(stderr, "%s.names: no F_CPU line\n", base);
+        exit(2);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        frames = (frame_t *) xrealloc(frames,
+                (nframes + 1) * sizeof(*frames));
+        memset(&frames[nframes], 0, sizeof(*frames));
+        if (sscanf(line, "%lu %47s", &seq, frames[nframes].name) != 2 ||
+                (nframes && seq <= frames[nframes - 1].seq)) {
+            fprintf(stderr, "%s.names: bad line %s", base, line);
+            exit(2);
+        }
+        frames[nframes++].seq = seq;
+    }
+    fclose(f);
+
+    f = open_file(base, "frames");
+    while (fgets(line, sizeof(line), f)) {
+        frame_t *fr;
+        strip_t *s;
+        uint16_t n;
+
+        seq = strtoul(strtok_r(line, " \n", &save), NULL, 10);
+        while (k + 1 < nframes && frames[k + 1].seq <= seq)
+            k++;
+        if (!nframes || seq < frames[k].seq) {
+            fprintf(stderr, "%s.frames: bad frame %lu\n", base, seq);
+            exit(2);
+        }
+        fr = &frames[k];
+        tok = strtok_r(NULL, " \n", &save);
+        if (seq != last)
+            fr->cycles += strtoul(tok, NULL, 10);
+        last = seq;
+        tok = strtok_r(NULL, " \n", &save);
+        pin = (uint8_t) atoi(strtok_r(NULL, " \n", &save));
+        for (j = 0; j < fr->nstrips; j++)
+            if (strcmp(fr->strip[j].port, tok) == 0 &&
+                    fr->strip[j].pin == pin)
+                break;
+        if (j == 16) {
+            fprintf(stderr, "%s.frames: bad frame %lu\n", base, seq);
+            exit(2);
+        }
+        s = &fr->strip[j];
+        if (j == fr->nstrips) {
+            fr->nstrips++;
+            snprintf(s->port, sizeof(s->port), "%s", tok);
+            s->pin = pin;
+        }
+        n = s->len;
+        while ((tok = strtok_r(NULL, " \n", &save))) {
+            pixel_bytes = (uint8_t) (strlen(tok) / 2);
+            s->grb = (uint8_t *) xrealloc(s->grb, (n + 1) * pixel_bytes);
+            for (i = 0; i < pixel_bytes; i++)
+                s->grb[n * pixel_bytes + i] = hex(tok + 2 * i);
+            n++;
+        }
+        s->len = n;
+        if (n > fr->len)
+            fr->len = n;
+    }
+    fclose(f);
+}
+
+static void fail(const char *base, size_t k, const char *fmt, ...)
+        __attribute__((format(printf, 3, 4)));
+
+static void fail(const char *base, size_t k, const char *fmt, ...) {
+    va_list ap;
+
+    fprintf(stderr, "%s: frame %lu %s: ", base, (unsigned long) k,
+            k < nframes ? frames[k].name : "?");
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    errors++;
+}
+
+/*
+ * Decode the pin of strip S between events B and E and check the bits.
+ * One cycle of slack is allowed on every edge as simavr timestamps the
+ * writes of 2-cycle instructions like sbi and cbi at their first cycle.
+ */
+static void check_strip(const char *base, size_t k, const strip_t *s,
+        size_t b, size_t e, uint8_t start) {
+    const uint32_t t0h = f_cpu / 4000000, t1h = f_cpu / 1000000;
+    const uint32_t bit = f_cpu / 800000;
+    const uint32_t gap = WS2811_MAX_GAP_US * (f_cpu / 1000000);
+    const uint32_t nbits = (uint32_t) s->len * 8 * pixel_bytes;
+    int sig = port_signal(s->port);
+    uint8_t level = (start >> s->pin) & 1, v;
+    uint64_t rise = 0, fall = 0;
+    uint32_t n = 0;
+    size_t i;
+
+    if (level) {
+        fail(base, k, "%s pin %u high before the call", s->port, s->pin);
+        return;
+    }
+    for (i = b; i < e; i++) {
+        if (events[i].signal != sig)
+            continue;
+        v = (events[i].value >> s->pin) & 1;
+        if (v == level)
+            continue;
+        level = v;
+        if (v) {
+            if (n > 0) {
+                uint64_t period = events[i].cycle - rise;
+
+                if (n % (8 * pixel_bytes) == 0 ?
+                        period + 1 < bit ||
+                        events[i].cycle - fall > gap :
+                        period + 1 < bit || period > bit + 1) {
+                    fail(base, k, "%s pin %u bit %lu: period %lu cycles, "
+                            "low for %lu", s->port, s->pin,
+                            (unsigned long) n, (unsigned long) period,
+                            (unsigned long) (events[i].cycle - fall));
+                    return;
+                }
+            }
+            rise = events[i].cycle;
+        } else {
+            uint64_t high = events[i].cycle - rise;
+            uint8_t one = high + 1 >= t1h && high <= t1h + 1;
+            uint8_t want;
+
+            if (!one && (high + 1 < t0h || high > t0h + 1)) {
+                fail(base, k, "%s pin %u bit %lu: high for %lu cycles",
+                        s->port, s->pin, (unsigned long) n,
+                        (unsigned long) high);
+                return;
+            }
+            if (n >= nbits) {
+                fail(base, k, "%s pin %u: more than %lu bits", s->port,
+                        s->pin, (unsigned long) nbits);
+                return;
+            }
+            want = (s->grb[n / 8] >> (7 - n % 8)) & 1;
+            if (one != want) {
+                fail(base, k, "%s pin %u pixel %lu byte %lu bit %lu: "
+                        "%u instead of %u", s->port, s->pin,
+                        (unsigned long) (n / 8 / pixel_bytes),
+                        (unsigned long) (n / 8 % pixel_bytes),
+                        (unsigned long) (7 - n % 8), one, want);
+                return;
+            }
+            fall = events[i].cycle;
+            n++;
+        }
+    }
+    if (level)
+        fail(base, k, "%s pin %u high after the call", s->port, s->pin);
+    else if (n != nbits)
+        fail(base, k, "%s pin %u: %lu bits instead of %lu", s->port, s->pin,
+                (unsigned long) n, (unsigned long) nbits);
+}
+
+/* USART: every byte is 5 UDR writes, 8 symbols of 10000 or 11110. */
+static void check_usart(const char *base, size_t k, const strip_t *s,
+        size_t b, size_t e) {
+    const uint32_t nbytes = (uint32_t) s->len * pixel_bytes;
+    int sig = port_signal(s->port);
+    uint8_t sym[40];
+    uint32_t n = 0, w = 0;
+    size_t i;
+
+    for (i = b; i < e; i++) {
+        if (events[i].signal != sig)
+            continue;
+        for (uint8_t j = 0; j < 8; j++)
+            sym[w * 8 + j] = (events[i].value >> (7 - j)) & 1;
+        if (++w < 5)
+            continue;
+        w = 0;
+        if (n >= nbytes) {
+            fail(base, k, "%s: more than %lu bytes", s->port,
+                    (unsigned long) nbytes);
+            return;
+        }
+        for (uint8_t j = 0; j < 8; j++) {
+            const uint8_t *p = sym + j * 5;
+            uint8_t want = (s->grb[n] >> (7 - j)) & 1;
+
+            if (!p[0] || p[1] != want || p[2] != want || p[3] != want ||
+                    p[4]) {
+                fail(base, k, "%s byte %lu bit %u: symbol %u%u%u%u%u for "
+                        "a %u", s->port, (unsigned long) n, 7 - j, p[0],
+                        p[1], p[2], p[3], p[4], want);
+                return;
+            }
+        }
+        n++;
+    }
+    if (w || n != nbytes)
+        fail(base, k, "%s: %lu bytes and %lu writes instead of %lu bytes",
+                s->port, (unsigned long) n, (unsigned long) w,
+                (unsigned long) nbytes);
+}
+
+/* New rows go after the previous routine's so they stay in call order. */
+static uint8_t add_row(uint8_t prev, const char *name, uint8_t strips,
+        unsigned col, long setup) {
+    uint8_t i;
+
+    for (i = 0; i < nrows; i++)
+        if (strcmp(rows[i].name, name) == 0)
+            break;
+    if (i == nrows) {
+        if (nrows == ARRAYLEN(rows))
+            return prev;
+        i = prev < nrows ? prev + 1 : 0;
+        memmove(&rows[i + 1], &rows[i], (nrows - i) * sizeof(rows[0]));
+        snprintf(rows[i].name, sizeof(rows[i].name), "%s", name);
+        rows[i].strips = strips;
+        memset(rows[i].setup, -1, sizeof(rows[i].setup));
+        nrows++;
+    }
+    if (setup > rows[i].setup[col])
+        rows[i].setup[col] = setup;
+    return i;
+}
+
+static void check(const char *base, unsigned col, int table) {
+    long cal = -1;
+    uint64_t start = 0;
+    uint8_t at_start[MAXSIGNALS], prev = 0xff;
+    size_t i, b = 0, k = 0;
+    int marker;
+
+    read_frames(base);
+    read_vcd(base);
+    marker = find_signal("GPIOR0");
+    if (marker < 0) {
+        fprintf(stderr, "%s.vcd: no GPIOR0 trace\n", base);
+        exit(2);
+    }
+    for (i = 0; i < nevents; i++) {
+        event_t *ev = &events[i];
+        uint8_t j;
+
+        if (ev->signal != marker) {
+            signals[ev->signal].value = ev->value;
+            continue;
+        }
+        if (ev->value == 2 || ev->value == 1) {
+            start = ev->cycle;
+            b = i + 1;
+            for (j = 0; j < nsignals; j++)
+                at_start[j] = signals[j].value;
+            if (ev->value == 1)
+                continue;
+        }
+        if (ev->value != 0)
+            continue;
+        if (cal < 0) {
+            cal = (long) (ev->cycle - start);
+            continue;
+        }
+        if (k >= nframes) {
+            fail(base, k, "more frames than expected");
+            break;
+        }
+
+        /* The frame is events b to i. */
+        frame_t *fr = &frames[k];
+        const uint32_t bits = (uint32_t) fr->len * 8 * pixel_bytes;
+        long cycles = (long) (ev->cycle - start) - cal;
+        long setup = cycles - (long) (bits * (f_cpu / 800000));
+        uint8_t mask[MAXSIGNALS] = { 0 };
+        uint8_t s, usart = 0;
+
+        for (s = 0; s < fr->nstrips; s++) {
+            int sig = port_signal(fr->strip[s].port);
+
+            if (sig < 0) {
+                fail(base, k, "%s not traced", fr->strip[s].port);
+                continue;
+            }
+            if (strncmp(fr->strip[s].port, "USART", 5) == 0) {
+                check_usart(base, k, &fr->strip[s], b, i);
+                mask[sig] = 0xff;
+                usart = 1;
+            } else {
+                check_strip(base, k, &fr->strip[s], b, i, at_start[sig]);
+                mask[sig] |= 1 << fr->strip[s].pin;
+            }
+        }
+        for (; b < i; b++) {
+            uint8_t sig = events[b].signal;
+
+            if ((events[b].value ^ at_start[sig]) & ~mask[sig]) {
+                fail(base, k, "%s changed to %02x from %02x",
+                        signals[sig].name, events[b].value, at_start[sig]);
+                break;
+            }
+        }
+        if (usart) {
+            /* Not timed by simavr. */
+            if (!table)
+                printf("%2luMHz %-25s %2u strips %3u px\n", f_cpu / 1000000,
+                        fr->name, fr->nstrips, fr->len);
+        } else if (table) {
+            if (!strchr(fr->name, '+'))
+                prev = add_row(prev, fr->name, fr->nstrips, col, setup);
+        } else {
+            printf("%2luMHz %-25s %2u strips %3u px %8.1fus setup %3ld "
+                    "(model %ld)\n", f_cpu / 1000000, fr->name, fr->nstrips,
+                    fr->len, cycles / (f_cpu / 1e6), setup,
+                    (long) fr->cycles - (long) (bits * (f_cpu / 800000)));
+        }
+        k++;
+    }
+    if (k != nframes)
+        fail(base, k, "%lu frames traced, %lu expected", (unsigned long) k,
+                (unsigned long) nframes);
+    for (k = 0; k < nframes; k++)
+        for (i = 0; i < frames[k].nstrips; i++)
+            free(frames[k].strip[i].grb);
+}
+
+/* The README.md table. */
+static void print_table(unsigned long *clocks, unsigned ncols) {
+    uint8_t i;
+    unsigned c;
+
+    printf("    routine                strips");
+    for (c = 0; c < ncols; c++) {
+        char h[32];
+
+        snprintf(h, sizeof(h), "setup @%luMHz", clocks[c] / 1000000);
+        printf("%15s", h);
+    }
+    putchar('\n');
+    for (i = 0; i < nrows; i++) {
+        printf("    %-22s %4u", rows[i].name, rows[i].strips);
+        for (c = 0; c < ncols; c++) {
+            char v[24] = "-";
+
+            if (rows[i].setup[c] >= 0)
+                snprintf(v, sizeof(v), "%ld", rows[i].setup[c]);
+            printf(c ? " %14s" : " %11s", v);
+        }
+        putchar('\n');
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned long clocks[8];
+    unsigned ncols = 0;
+    int table = 0, i;
+
+    if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+        table = 1;
+        argc--;
+        argv++;
+    }
+    if (argc < 2 || argc > 9) {
+        fprintf(stderr, "usage: ws2811check [-t] BASE...\n");
+        return 2;
+    }
+    for (i = 1; i < argc; i++) {
+        check(argv[i], ncols, table);
+        clocks[ncols++] = f_cpu;
+    }
+    if (table)
+        print_table(clocks, ncols);
+    if (errors)
+        fprintf(stderr, "%u errors\n", errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Encode an animation for WS2811_OUT_1_RLE.
+ *
+ * Reads raw frames of LEN pixels from stdin, 3 bytes per pixel in R, G, B
+ * order (e.g. ffmpeg -f rawvideo -pix_fmt rgb24), and writes C source to
+ * stdout declaring NAME, a PROGMEM array with the runs of all the frames,
+ * and NAME_frame, the offset of every frame's first run in NAME.  A frame
+ * is then output with e.g.
+ *   WS2811RLE(NAME + pgm_read_word(&NAME_frame[i]), LEN);
+ * Runs don't cross frames so every frame can be output on its own.
+ * Build natively: gcc -std=gnu99 -I.. ws2811rle.c -o ws2811rle
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <WS2811.h>
+
+static int out_of_memory(const char *prog) {
+    fprintf(stderr, "%s: out of memory\n", prog);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *name;
+    char *end;
+    unsigned long arg;
+    uint16_t len, i;
+    uint32_t offset = 0, frames = 0, *frame = NULL, *new_frame, n, j;
+    RGB_t *rgb;
+    uint8_t *runs = NULL, *new_runs, px[3];
+
+    if (argc == 3)
+        arg = strtoul(argv[2], &end, 10);
+    if (argc != 3 || *argv[2] < '0' || *argv[2] > '9' || *end ||
+            arg == 0 || arg > 0xffff) {
+        fprintf(stderr, "usage: %s NAME LEN < frames.rgb > frames.h\n"
+                "LEN is 1 to 65535 pixels\n", argv[0]);
+        return 1;
+    }
+    name = argv[1];
+    len = (uint16_t) arg;
+    rgb = (RGB_t *) malloc((size_t) len * sizeof(RGB_t));
+    if (!rgb)
+        return out_of_memory(argv[0]);
+
+    /* Encode everything first so that nothing is printed if it's too big. */
+    for (;;) {
+        for (i = 0; i < len && fread(px, 3, 1, stdin) == 1; i++) {
+            rgb[i].r = px[0];
+            rgb[i].g = px[1];
+            rgb[i].b = px[2];
+        }
+        if (i < len)
+            break;
+        new_frame = (uint32_t *) realloc(frame,
+                (frames + 1) * sizeof(*frame));
+        if (!new_frame)
+            return out_of_memory(argv[0]);
+        frame = new_frame;
+        new_runs = (uint8_t *) realloc(runs, offset + (size_t) len * 4);
+        if (!new_runs)
+            return out_of_memory(argv[0]);
+        runs = new_runs;
+        frame[frames++] = offset;
+        offset += WS2811_rle_encode(rgb, len, runs + offset);
+        if (offset > 0xffff) {
+            fprintf(stderr, "%s: the runs don't fit in 64KB, %lu bytes "
+                    "by frame %lu\n", argv[0], (unsigned long) offset,
+                    (unsigned long) frames - 1);
+            return 1;
+        }
+    }
+
+    printf("/* Generated by ws2811rle, %u pixels per frame */\n",
+            (unsigned) len);
+    printf("const uint8_t %s[] PROGMEM = {\n", name);
+    for (n = 0; n < frames; n++) {
+        printf("    /* frame %lu */\n", (unsigned long) n);
+        for (j = frame[n]; j < (n + 1 < frames ? frame[n + 1] : offset);
+                j += 4)
+            printf("    %u, 0x%02x, 0x%02x, 0x%02x,\n",
+                    runs[j], runs[j + 1], runs[j + 2], runs[j + 3]);
+    }
+    printf("};\n\n");
+    printf("const uint16_t %s_frame[%lu] PROGMEM = {\n", name,
+            (unsigned long) frames);
+    for (n = 0; n < frames; n++)
+        printf("    %lu,\n", (unsigned long) frame[n]);
+    printf("};\n");
+    fprintf(stderr, "%lu frames, %lu bytes (%lu raw)\n",
+            (unsigned long) frames, (unsigned long) offset,
+            (unsigned long) frames * len * 3);
+    return 0;
+}